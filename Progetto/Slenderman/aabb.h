@@ -16,17 +16,12 @@ private:
 
     unsigned int _vao = 0;
 
-    bool _hasIntersection = false;
-    bool _shouldBeRendered = false;
-
     static void _updateWithVertex(const Vertex& vertex, glm::vec3& min, glm::vec3& max);
 
     static void _updateWithVertex(const glm::vec3& vertex, glm::vec3& min, glm::vec3& max);
 
     static aabb* _applyTransformToMinMax(const glm::mat4& transform, const glm::vec3& currentMin, const glm::vec3& currentMax);
 
-    void _resetCurrentIntersection();
-
 public:
 
     aabb(glm::vec3 p_min, glm::vec3 p_max) : min(p_min), max(p_max) {}
@@ -35,24 +30,13 @@ public:
 
     static vector<aabb*> fromCompoundModel(const Model& model, const vector<glm::vec3>& centroids, const glm::mat4& transform = glm::mat4(1));
 
-    bool intersectRay2D(const ray& ray, const float& maxDistance = 5.0f);
-
-    inline bool hasIntersection() const { return _hasIntersection; }
+    bool intersectRay2D(const ray& ray, const float& maxDistance = 5.0f) const;
 
     inline glm::vec3 getMin() const { return min; }
 
     inline glm::vec3 getMax() const { return max; }
-
-    inline bool shouldBeRendered() { return _shouldBeRendered; }
-
-    inline void disableRendering() { _shouldBeRendered = false; }
 };
 
-void aabb::_resetCurrentIntersection() {
-    _hasIntersection = false;
-    _shouldBeRendered = true;
-}
-
 void aabb::_updateWithVertex(const Vertex& vertex, glm::vec3& min, glm::vec3& max) {
     _updateWithVertex(vertex.Position, min, max);
 }
@@ -138,7 +122,7 @@ vector<aabb*> aabb::fromCompoundModel(const Model& model, const vector<glm::vec3
     return result;
 }
 
-bool aabb::intersectRay2D(const ray& ray, const float& maxDistance) {
+bool aabb::intersectRay2D(const ray& ray, const float& maxDistance) const {
     float txMin = (min.x - ray.origin.x) / ray.direction.x;
     float txMax = (max.x - ray.origin.x) / ray.direction.x;
 
@@ -164,6 +148,5 @@ bool aabb::intersectRay2D(const ray& ray, const float& maxDistance) {
     if ((txMin > tzMax) || (tzMin > txMax))
         return false;
 
-    _hasIntersection = true;
     return true;
 }
@@ -2,10 +2,16 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
 
 void main()
 {
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    gl_Position = viewProjection * vec4(aPos, 1.0);
 }
\ No newline at end of file
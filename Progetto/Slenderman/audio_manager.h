@@ -1,10 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <set>
 #include <string>
+#include <thread>
 
 #include "raudio/raudio.h"
 
+#include "constants.h"
+#include "map_random.h"
+#include "spsc_queue.h"
+
 enum class ESfx {
     lightOn,
     footstep1,
@@ -19,44 +27,92 @@ enum class EMusic {
     highFear,
 };
 
+enum class EAudioCommand {
+    loadMusic,
+    loadSfx,
+    playMusicFromBeginning,
+    pauseMusic,
+    setMusicVolume,
+    playSfx,
+    shutdown,
+};
+
+struct AudioCommand {
+    EAudioCommand type = EAudioCommand::shutdown;
+    int key = 0;
+    float volume = 1.0f;
+    bool flag = false;
+    std::string path;
+};
+
+struct AudioStats {
+    unsigned int underruns = 0;         // stimati: aggiornamenti dello stream arrivati oltre AUDIO_UNDERRUN_GAP_SECONDS
+    unsigned int droppedCommands = 0;   // comandi persi a coda piena
+    float maxUpdateGap = 0.0f;          // secondi
+};
+
+// Tutte le chiamate a raudio (device, caricamento, streaming delle musiche) avvengono sul thread audio.
+// Il thread di gioco invia comandi attraverso una coda SPSC senza lock e non si blocca mai
 class AudioManager {
 private:
+    // Stato del thread audio
     std::map<ESfx, Sound> _sfxCache;
     std::map<EMusic, Music> _musicCache;
+    std::chrono::steady_clock::time_point _lastUpdate;
+
+    // Stato del thread di gioco
+    std::set<EMusic> _loadedMusic;
+    std::map<EMusic, float> _musicVolumes;
+    // Passi riprodotti: la variante dipende solo dal contatore, non da rand() condiviso con altri thread
+    uint32_t _footstepDraw = 0;
 
-    bool audioInitialized = false;
+    std::thread _thread;
+    std::atomic<bool> _running{ false };
+    SpscQueue<AudioCommand, AUDIO_COMMAND_QUEUE_SIZE> _commands;
+
+    std::atomic<bool> _footstepPlaying{ false };
+    std::atomic<unsigned int> _underruns{ 0 };
+    std::atomic<unsigned int> _droppedCommands{ 0 };
+    std::atomic<float> _maxUpdateGap{ 0.0f };
 
     AudioManager() {}
 
+    // False se la coda e' piena e il comando e' stato scartato
+    bool _post(AudioCommand&& command);
+    void _run();
+    void _execute(const AudioCommand& command);
+    void _updateStreams();
+
 public:
     AudioManager(AudioManager const&) = delete;
     void operator=(AudioManager const&) = delete;
 
     static AudioManager& getInstance();
 
-    inline void initAudio() const;
+    void initAudio();
 
     void loadMusic(EMusic key, std::string filePath, bool autoplay = false, float volume = 1.0f);
 
-    void playMusicFromBeginning(EMusic key, float volume = 1.0f) const;
+    void playMusicFromBeginning(EMusic key, float volume = 1.0f);
 
-    void pauseMusic(EMusic key) const;
+    void pauseMusic(EMusic key);
 
-    void setMusicVolume(EMusic key, float volume) const;
+    void setMusicVolume(EMusic key, float volume);
 
     void loadSfx(ESfx key, std::string filePath, float volume = 1.0f);
 
-    void playSfx(ESfx key, bool setVolume = false, float volume = 1.0f) const;
+    void playSfx(ESfx key, bool setVolume = false, float volume = 1.0f);
 
-    void playRandomFootstep() const;
+    void playRandomFootstep();
 
-    bool isPlayingFootstep() const;
+    // Stato pubblicato dal thread audio all'ultimo aggiornamento
+    inline bool isPlayingFootstep() const { return _footstepPlaying.load(std::memory_order_relaxed); }
 
-    void process() const;
+    AudioStats stats() const;
 
     void destroy();
 
-    inline bool has(EMusic key) const { return _musicCache.find(key) != _musicCache.end(); }
+    inline bool has(EMusic key) const { return _loadedMusic.find(key) != _loadedMusic.end(); }
 
 };
 
@@ -65,100 +121,234 @@ AudioManager& AudioManager::getInstance() {
     return instance;
 }
 
-inline void AudioManager::initAudio() const {
-    InitAudioDevice();
+void AudioManager::initAudio() {
+    if (_running)
+        return;
+
+    _running = true;
+    _thread = std::thread(&AudioManager::_run, this);
 }
 
-void AudioManager::loadMusic(EMusic key, std::string filePath, bool autoplay, float volume) {
-    Music music = LoadMusicStream(filePath.c_str());
-    if (autoplay) {
-        SetMusicVolume(music, volume);
-        PlayMusicStream(music);
-    }
-    _musicCache[key] = music;
+bool AudioManager::_post(AudioCommand&& command) {
+    if (_commands.push(std::move(command)))
+        return true;
+
+    _droppedCommands++;
+    return false;
 }
 
-void AudioManager::playMusicFromBeginning(EMusic key, float volume) const {
-    auto music = _musicCache.find(key);
-    if (music == _musicCache.end())
+void AudioManager::loadMusic(EMusic key, std::string filePath, bool autoplay, float volume) {
+    AudioCommand command;
+    command.type = EAudioCommand::loadMusic;
+    command.key = static_cast<int>(key);
+    command.path = filePath;
+    command.flag = autoplay;
+    command.volume = volume;
+    if (!_post(std::move(command)))
         return;
+
+    _loadedMusic.insert(key);
+    _musicVolumes[key] = volume;
+}
+
+void AudioManager::playMusicFromBeginning(EMusic key, float volume) {
     if (volume > 1.0)
         volume = 1.0;
-    SetMusicVolume(music->second, volume);
-    SeekMusicStream(music->second, 0.0f);
-    PlayMusicStream(music->second);
+
+    AudioCommand command;
+    command.type = EAudioCommand::playMusicFromBeginning;
+    command.key = static_cast<int>(key);
+    command.volume = volume;
+    if (_post(std::move(command)))
+        _musicVolumes[key] = volume;
 }
 
-void AudioManager::pauseMusic(EMusic key) const {
-    auto music = _musicCache.find(key);
-    if (music == _musicCache.end())
-        return;
-    PauseMusicStream(music->second);
+void AudioManager::pauseMusic(EMusic key) {
+    AudioCommand command;
+    command.type = EAudioCommand::pauseMusic;
+    command.key = static_cast<int>(key);
+    _post(std::move(command));
 }
 
-void AudioManager::setMusicVolume(EMusic key, float volume) const {
+void AudioManager::setMusicVolume(EMusic key, float volume) {
     if (volume < 0)
         volume = 0;
-    auto music = _musicCache.find(key);
-    if (music == _musicCache.end())
+
+    // Il volume viene impostato a ogni frame: si inviano solo le variazioni
+    auto current = _musicVolumes.find(key);
+    if (current != _musicVolumes.end() && current->second == volume)
         return;
-    SetMusicVolume(music->second, volume);
+
+    AudioCommand command;
+    command.type = EAudioCommand::setMusicVolume;
+    command.key = static_cast<int>(key);
+    command.volume = volume;
+    // Se il comando viene scartato il volume resta da inviare al frame successivo
+    if (_post(std::move(command)))
+        _musicVolumes[key] = volume;
 }
 
 void AudioManager::loadSfx(ESfx key, std::string filePath, float volume) {
-    Sound sound = LoadSound(filePath.c_str());
-    SetSoundVolume(sound, volume);
-    _sfxCache[key] = sound;
+    AudioCommand command;
+    command.type = EAudioCommand::loadSfx;
+    command.key = static_cast<int>(key);
+    command.path = filePath;
+    command.volume = volume;
+    _post(std::move(command));
 }
 
-void AudioManager::playSfx(ESfx key, bool setVolume, float volume) const {
-    auto sfx = _sfxCache.find(key);
-    if (sfx == _sfxCache.end())
-        return;
+void AudioManager::playSfx(ESfx key, bool setVolume, float volume) {
+    if (volume > 1.0)
+        volume = 1.0;
 
-    if (setVolume) {
-        if (volume > 1.0)
-            volume = 1.0;
-        SetSoundVolume(sfx->second, volume);
-    }
+    AudioCommand command;
+    command.type = EAudioCommand::playSfx;
+    command.key = static_cast<int>(key);
+    command.flag = setVolume;
+    command.volume = volume;
+    _post(std::move(command));
+}
 
-    PlaySound(sfx->second);
+void AudioManager::playRandomFootstep() {
+    int footstepIndex = static_cast<int>(ESfx::footstep1) + MapRandom::randomInt(0, _footstepDraw++, static_cast<int>(ESfx::footstep3) - static_cast<int>(ESfx::footstep1) + 1);
+    playSfx(static_cast<ESfx>(footstepIndex));
+    // Evita un secondo passo prima che il thread audio abbia pubblicato lo stato
+    _footstepPlaying = true;
 }
 
-void AudioManager::playRandomFootstep() const {
-    int footstepIndex = static_cast<int>(ESfx::footstep1) + (std::rand() % (static_cast<int>(ESfx::footstep3) - static_cast<int>(ESfx::footstep1) + 1));
-    PlaySound(_sfxCache.find(static_cast<ESfx>(footstepIndex))->second);
+void AudioManager::_run() {
+    InitAudioDevice();
+    _lastUpdate = std::chrono::steady_clock::now();
+
+    AudioCommand command;
+    while (_running) {
+        while (_commands.pop(command)) {
+            if (command.type == EAudioCommand::shutdown) {
+                _running = false;
+                break;
+            }
+            _execute(command);
+        }
+
+        _updateStreams();
+        std::this_thread::sleep_for(std::chrono::milliseconds(AUDIO_THREAD_PERIOD_MS));
+    }
+
+    for (const auto& music : _musicCache)
+        UnloadMusicStream(music.second);
+    _musicCache.clear();
+
+    for (const auto& sfx : _sfxCache)
+        UnloadSound(sfx.second);
+    _sfxCache.clear();
+
+    CloseAudioDevice();
 }
 
-bool AudioManager::isPlayingFootstep() const {
-    for (int i = static_cast<int>(ESfx::footstep1); i <= static_cast<int>(ESfx::footstep3); i++) {
-        auto sfx = _sfxCache.find(static_cast<ESfx>(i));
+void AudioManager::_execute(const AudioCommand& command) {
+    if (command.type == EAudioCommand::loadMusic) {
+        Music music = LoadMusicStream(command.path.c_str());
+        if (command.flag) {
+            SetMusicVolume(music, command.volume);
+            PlayMusicStream(music);
+        }
+        _musicCache[static_cast<EMusic>(command.key)] = music;
+        return;
+    }
+
+    if (command.type == EAudioCommand::loadSfx) {
+        Sound sound = LoadSound(command.path.c_str());
+        SetSoundVolume(sound, command.volume);
+        _sfxCache[static_cast<ESfx>(command.key)] = sound;
+        return;
+    }
+
+    if (command.type == EAudioCommand::playSfx) {
+        auto sfx = _sfxCache.find(static_cast<ESfx>(command.key));
         if (sfx == _sfxCache.end())
-            continue;
-        if (IsSoundPlaying(sfx->second))
-            return true;
+            return;
+        if (command.flag)
+            SetSoundVolume(sfx->second, command.volume);
+        PlaySound(sfx->second);
+        return;
+    }
+
+    auto music = _musicCache.find(static_cast<EMusic>(command.key));
+    if (music == _musicCache.end())
+        return;
+
+    switch (command.type) {
+    case EAudioCommand::playMusicFromBeginning:
+        SetMusicVolume(music->second, command.volume);
+        SeekMusicStream(music->second, 0.0f);
+        PlayMusicStream(music->second);
+        break;
+    case EAudioCommand::pauseMusic:
+        PauseMusicStream(music->second);
+        break;
+    case EAudioCommand::setMusicVolume:
+        SetMusicVolume(music->second, command.volume);
+        break;
+    default:
+        break;
     }
-    return false;
 }
 
-void AudioManager::process() const {
+void AudioManager::_updateStreams() {
+    auto now = std::chrono::steady_clock::now();
+    float gap = std::chrono::duration<float>(now - _lastUpdate).count();
+    _lastUpdate = now;
+
+    bool anyPlaying = false;
     for (const auto& music : _musicCache) {
         if (!IsMusicStreamPlaying(music.second))
             continue;
+        anyPlaying = true;
 
         if (GetMusicTimePlayed(music.second) > GetMusicTimeLength(music.second))
             SeekMusicStream(music.second, 0.0f);
 
         UpdateMusicStream(music.second);
     }
+
+    // raudio non espone lo stato dei buffer: un aggiornamento troppo distanziato dal precedente conta come underrun
+    if (anyPlaying) {
+        if (gap > AUDIO_UNDERRUN_GAP_SECONDS)
+            _underruns++;
+        if (gap > _maxUpdateGap.load(std::memory_order_relaxed))
+            _maxUpdateGap.store(gap, std::memory_order_relaxed);
+    }
+
+    bool footstepPlaying = false;
+    for (int i = static_cast<int>(ESfx::footstep1); i <= static_cast<int>(ESfx::footstep3); i++) {
+        auto sfx = _sfxCache.find(static_cast<ESfx>(i));
+        if (sfx != _sfxCache.end() && IsSoundPlaying(sfx->second))
+            footstepPlaying = true;
+    }
+    _footstepPlaying.store(footstepPlaying, std::memory_order_relaxed);
+}
+
+AudioStats AudioManager::stats() const {
+    AudioStats stats;
+    stats.underruns = _underruns.load(std::memory_order_relaxed);
+    stats.droppedCommands = _droppedCommands.load(std::memory_order_relaxed);
+    stats.maxUpdateGap = _maxUpdateGap.load(std::memory_order_relaxed);
+    return stats;
 }
 
 void AudioManager::destroy() {
-    for (const auto& music : _musicCache)
-        UnloadMusicStream(music.second);
+    if (!_running)
+        return;
 
-    for (const auto& sfx : _sfxCache)
-        UnloadSound(sfx.second);
+    // La coda potrebbe essere piena: in quel caso si ferma il thread direttamente
+    AudioCommand command;
+    command.type = EAudioCommand::shutdown;
+    if (!_commands.push(std::move(command)))
+        _running = false;
 
-    CloseAudioDevice();
-}
\ No newline at end of file
+    if (_thread.joinable())
+        _thread.join();
+
+    _loadedMusic.clear();
+    _musicVolumes.clear();
+}
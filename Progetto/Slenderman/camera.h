@@ -67,7 +67,7 @@ public:
     return glm::lookAt(Position, Position + Front, Up);
   }
 
-  glm::mat4 GetProjection(float farClippingPlane = 300.0f) const {
+  glm::mat4 GetProjection(float farClippingPlane = FAR_CLIPPING_PLANE) const {
       // nTODO: Precalcolare la divisione SCR_W / SCR_H
       return glm::perspective(glm::radians(Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, farClippingPlane);
   }
@@ -110,6 +110,13 @@ public:
     updateCameraVectors();
   }
 
+  // sets the Euler angles directly (e.g. from a simulation snapshot)
+  void SetOrientation(float yaw, float pitch) {
+    Yaw = yaw;
+    Pitch = pitch;
+    updateCameraVectors();
+  }
+
   // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
   void ProcessMouseScroll(float yoffset) {
     Zoom -= (float)yoffset;
@@ -4,26 +4,34 @@
 #include <math.h>
 #include <map>
 #include <set>
+#include <unordered_set>
 #include <vector>
 
 #include "aabb.h"
 #include "camera.h"
+#include "memory_stats.h"
 #include "ray.h"
 
 struct CollisionResult {
     bool n = false, s = false, e = false, w = false;
     bool ne, nw, se, sw;
 
+    // AABB controllati e intersecati, per il debug: vengono pubblicati nello snapshot invece di marcare gli AABB
+    std::vector<const aabb*> testedAABBs;
+    std::vector<const aabb*> intersectedAABBs;
+
     inline bool isColliding() const {
         return n || s || e || w;
     }
 };
 
-class CollisionSolver {
+class CollisionSolver : public MemoryReporter {
 private:
     static const int kCells = 250;
 
     std::map<std::pair<int, int>, std::vector<aabb*>> _registeredAABBs;
+    // AABB di proprieta' di altri (WorldCache): non vengono liberati da clearRegisteredAABBs
+    std::unordered_set<aabb*> _sharedAABBs;
 
     inline std::pair<int, int> _hash(int x, int y) const;
 
@@ -31,13 +39,16 @@ private:
 
     inline std::vector<glm::ivec2> _indices(const aabb& staticAABB) const;
 
-    void _processCollision(CollisionResult& collisionResult, const Camera& camera, aabb* staticAABB, const float& maxDistance = 5.0f) const;
+    // Vero se almeno un raggio interseca l'AABB
+    bool _processCollision(CollisionResult& collisionResult, const Camera& camera, const aabb* staticAABB, const float& maxDistance = 5.0f) const;
 
 public:
     void registerAABB(aabb* staticAABB);
 
     void registerAABBs(const std::vector<aabb*>& staticAABBs);
 
+    void registerSharedAABBs(const std::vector<aabb*>& staticAABBs);
+
     std::vector<aabb*> registeredAABBNear(const glm::vec3& vector) const;
 
     std::vector<aabb*> registeredAABBNear(const aabb& boundigBox) const;
@@ -47,8 +58,25 @@ public:
     CollisionResult checkCollisionWithRegisteredAABBs(const Camera& camera, const float& maxDistance = 5.0f, const float& cameraMargin = 5.0f) const;
 
     void clearRegisteredAABBs();
+
+    // Celle della griglia e AABB posseduti, quelli condivisi sono contati da chi li possiede
+    virtual MemoryUsage memoryUsage() const override;
 };
 
+MemoryUsage CollisionSolver::memoryUsage() const {
+    MemoryUsage usage;
+    // Un AABB puo' stare in piu' celle
+    std::unordered_set<const aabb*> owned;
+    for (const auto& cell : _registeredAABBs) {
+        usage.cpuBytes += sizeof(cell) + vectorBytes(cell.second);
+        for (auto staticAABB : cell.second)
+            if (_sharedAABBs.find(staticAABB) == _sharedAABBs.end())
+                owned.insert(staticAABB);
+    }
+    usage.cpuBytes += owned.size() * sizeof(aabb) + _sharedAABBs.size() * sizeof(aabb*);
+    return usage;
+}
+
 inline std::pair<int, int> CollisionSolver::_hash(int x, int z) const {
     return { x, z };
 }
@@ -96,6 +124,13 @@ void CollisionSolver::registerAABBs(const std::vector<aabb*>& staticAABBs) {
         registerAABB(staticAABB);
 }
 
+void CollisionSolver::registerSharedAABBs(const std::vector<aabb*>& staticAABBs) {
+    for (auto staticAABB : staticAABBs) {
+        _sharedAABBs.insert(staticAABB);
+        registerAABB(staticAABB);
+    }
+}
+
 std::vector<aabb*> CollisionSolver::registeredAABBNear(const glm::vec3& vector) const {
     auto indices = _indices(vector);
     auto hash = _hash(indices.x, indices.y);
@@ -139,28 +174,35 @@ CollisionResult CollisionSolver::checkCollisionWithRegisteredAABBs(const Camera&
     );
     auto currentAABBs = registeredAABBNear(cameraAABB);
     for (auto staticAABB : currentAABBs) {
-        staticAABB->_resetCurrentIntersection();
-        _processCollision(result, camera, staticAABB, maxDistance);
+        result.testedAABBs.push_back(staticAABB);
+        if (_processCollision(result, camera, staticAABB, maxDistance))
+            result.intersectedAABBs.push_back(staticAABB);
     }
     return result;
 }
 
-void CollisionSolver::_processCollision(CollisionResult& collisionResult, const Camera& camera, aabb* staticAABB, const float& maxDistance) const {
+bool CollisionSolver::_processCollision(CollisionResult& collisionResult, const Camera& camera, const aabb* staticAABB, const float& maxDistance) const {
     auto cameraPosition = camera.Position;
 
     ray frontRay(cameraPosition, camera.Front);
     frontRay.direction.y = 0;
-    collisionResult.n = collisionResult.n || staticAABB->intersectRay2D(frontRay, maxDistance);
+    bool n = staticAABB->intersectRay2D(frontRay, maxDistance);
 
     ray backRay = frontRay.rotate(M_PI, glm::vec3(0, 1, 0));
     backRay.direction.y = 0;
-    collisionResult.s = collisionResult.s || staticAABB->intersectRay2D(backRay, maxDistance);
+    bool s = staticAABB->intersectRay2D(backRay, maxDistance);
 
     ray rightRay(cameraPosition, camera.Right);
-    collisionResult.e = collisionResult.e || staticAABB->intersectRay2D(rightRay, maxDistance);
+    bool e = staticAABB->intersectRay2D(rightRay, maxDistance);
 
     ray leftRay = rightRay.rotate(M_PI, glm::vec3(0, 1, 0));
-    collisionResult.w = collisionResult.w || staticAABB->intersectRay2D(leftRay, maxDistance);
+    bool w = staticAABB->intersectRay2D(leftRay, maxDistance);
+
+    collisionResult.n = collisionResult.n || n;
+    collisionResult.s = collisionResult.s || s;
+    collisionResult.e = collisionResult.e || e;
+    collisionResult.w = collisionResult.w || w;
+    return n || s || e || w;
 }
 
 void CollisionSolver::clearRegisteredAABBs() {
@@ -168,10 +210,12 @@ void CollisionSolver::clearRegisteredAABBs() {
 
     for (auto cell : _registeredAABBs)
         for (auto staticAABB : cell.second)
-            aabbs.insert(staticAABB);
+            if (_sharedAABBs.find(staticAABB) == _sharedAABBs.end())
+                aabbs.insert(staticAABB);
 
     for (auto staticAABB : aabbs)
         delete staticAABB;
 
     _registeredAABBs.clear();
+    _sharedAABBs.clear();
 }
\ No newline at end of file
@@ -23,6 +23,9 @@ const float TREE_OFFSET = 40.0f;
 const int GRASS_QUAD_SIDE = 640;
 const int VAO_OBJECTS_SIDE_GRASS = 10;
 const float GRASS_OFFSET = 6.0f;
+// Se attivo le trasformazioni dell'erba sono calcolate nel vertex shader a partire dal seed
+// del chunk e non viene allocato alcun buffer per istanza
+const bool PROCEDURAL_GRASS = true;
 // Non cambiare il fence offset altrimenti le parti di recinto non combaciano
 const float FENCE_OFFSET = 16.8f;
 const int NUM_FENCES_FOR_SIDE = 160;
@@ -38,12 +41,130 @@ const std::unordered_set<int> K_SET_TO_EXCLUDE = { 300 };
 // Indica l'offset che ha il lampione lungo x e lungo z dal centro del VAO
 const float STREETLIGHT_POI_OFFSET = 10.0f;
 const float SLENDERMAN_OUT_OF_TREE_OFFSET = 5.0f;
+// Seed della mappa: a parita' di seed la mappa generata e' identica. Con 0 viene scelto a ogni partita
+const unsigned int MAP_SEED = 0;
+// Thread usati per la generazione della mappa, con 0 tutti i core disponibili
+const unsigned int MAP_GENERATION_THREADS = 0;
+
+// COSTANTI PER GLI IMPOSTOR DEGLI ALBERI
+// -------------------------------------------------------------------------------------------
+// Se attivo i chunk di alberi oltre IMPOSTOR_DISTANCE vengono disegnati come billboard
+const bool USE_TREE_IMPOSTORS = true;
+// Distanza (dal centro del chunk) oltre la quale gli alberi diventano impostor
+const float IMPOSTOR_DISTANCE = 180.0f;
+// Numero di angolazioni da cui viene pre-renderizzato l'albero nell'atlas
+const int IMPOSTOR_ANGLES = 8;
+// Dimensione in pixel di ogni frame dell'atlas
+const int IMPOSTOR_FRAME_SIZE = 256;
+// Gli alberi lontani sono quasi al buio, il colore dell'atlas viene scurito di conseguenza
+const float IMPOSTOR_BRIGHTNESS = 0.05f;
+// Piano lontano della proiezione: gli impostor coprono la corona tra IMPOSTOR_DISTANCE e questa distanza
+const float FAR_CLIPPING_PLANE = 300.0f;
 
 const float MAX_PLAYER_DISTANCE_FRONT = -1343.0f;
 const float MAX_PLAYER_DISTANCE_BACK = 1343.5f;
 const float MAX_PLAYER_DISTANCE_RIGHT = 1333.5f;
 const float MAX_PLAYER_DISTANCE_LEFT = -1353.5f;
 
+// COSTANTI PER LA SIMULAZIONE
+// -------------------------------------------------------------------------------------------
+// Frequenza (tick al secondo) del thread di simulazione, il rendering interpola tra due tick
+const int SIMULATION_TICK_RATE = 60;
+// Tick massimi recuperati a ogni risveglio: oltre, il ritardo viene scartato invece di accumularsi
+const int SIMULATION_MAX_STEPS = 5;
+// Delta massimo (secondi) riportato dal clock di frame
+const double MAX_FRAME_DELTA = 0.25;
+
+// COSTANTI PER IL FRAME PACING
+// -------------------------------------------------------------------------------------------
+// Frame rate massimo, 0 per non limitarlo
+const int FRAME_PACING_TARGET_FPS = 120;
+// Frame che la CPU puo' accodare alla GPU prima di attenderne il completamento
+const unsigned int FRAME_PACING_MAX_FRAMES_IN_FLIGHT = 2;
+// Margine minimo (secondi) lasciato allo spin-wait prima della scadenza del frame
+const double FRAME_PACING_MIN_SPIN_MARGIN = 0.002;
+// Numero di frame su cui si calcolano i percentili
+const unsigned int FRAME_PACING_HISTORY = 240;
+// Un frame e' in ritardo se dura piu' di questo fattore per il tempo obiettivo
+const float FRAME_PACING_LATE_FACTOR = 1.5f;
+
+// COSTANTI PER LA RISOLUZIONE DINAMICA
+// -------------------------------------------------------------------------------------------
+// Se attivo la scena 3D viene disegnata a risoluzione ridotta quando supera il budget GPU
+const bool USE_DYNAMIC_RESOLUTION = true;
+// Tempo GPU (millisecondi) concesso alla scena 3D
+const float DYNAMIC_RESOLUTION_BUDGET_MS = 6.0f;
+// Sotto questa frazione del budget la risoluzione torna a salire
+const float DYNAMIC_RESOLUTION_HEADROOM = 0.8f;
+const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+// Variazione massima della scala per misura e granularita' della scala
+const float DYNAMIC_RESOLUTION_MAX_STEP = 0.1f;
+const float DYNAMIC_RESOLUTION_STEP = 0.05f;
+// Query in volo: il risultato si legge con questo ritardo in frame
+const unsigned int DYNAMIC_RESOLUTION_QUERIES = 4;
+
+// COSTANTI PER L'OCCLUSION CULLING
+// -------------------------------------------------------------------------------------------
+// Se attivo chunk e oggetti nascosti dalla profondita' dei frame precedenti non vengono inviati alla coda
+const bool USE_OCCLUSION_CULLING = true;
+// Profondita' ridotta letta dalla CPU, livello 0 della piramide Hi-Z
+const int HI_Z_WIDTH = 256;
+const int HI_Z_HEIGHT = 128;
+// PBO in volo: la piramide usata nei test ha questo ritardo in frame
+const unsigned int HI_Z_READBACK_FRAMES = 3;
+// Margine (unita' del mondo) tra l'oggetto e l'occluder, copre il movimento della camera durante il ritardo
+const float HI_Z_DEPTH_MARGIN = 2.0f;
+
+// COSTANTI PER LO STREAMING DEI DATI DINAMICI
+// -------------------------------------------------------------------------------------------
+// Regioni del buffer di streaming: una in piu' dei frame in volo, la regione da riusare e' gia' libera
+const unsigned int STREAMING_BUFFER_FRAMES = FRAME_PACING_MAX_FRAMES_IN_FLIGHT + 1;
+// Byte di ogni regione, raddoppiati se un singolo caricamento non ci sta
+const size_t STREAMING_BUFFER_REGION_SIZE = 1024 * 1024;
+
+// COSTANTI PER LE STATISTICHE DI MEMORIA
+// -------------------------------------------------------------------------------------------
+// Report JSON scritto alla fine di ogni partita (solo in DEBUG)
+const char* MEMORY_REPORT_PATH = "memory_report.json";
+// Intervallo di aggiornamento delle statistiche di memoria nell'overlay
+const double MEMORY_STATS_REFRESH_SECONDS = 1.0;
+
+// COSTANTI PER L'IMPORT DEI MODELLI
+// -------------------------------------------------------------------------------------------
+// Se attivo le mesh vengono saldate e riordinate per la cache dei vertici, l'overdraw e il fetch
+const bool USE_MESH_OPTIMIZATION = true;
+// Vertici della cache FIFO simulata per ACMR/ATVR e per dividere le mesh in cluster
+const unsigned int MESH_OPTIMIZER_CACHE_SIZE = 16;
+// Peggioramento massimo dell'ACMR accettato per l'ordine anti-overdraw
+const float MESH_OPTIMIZER_OVERDRAW_THRESHOLD = 1.05f;
+
+// COSTANTI PER IL CARICAMENTO DELLE TEXTURE
+// -------------------------------------------------------------------------------------------
+// Numero di PBO usati a rotazione per i caricamenti asincroni
+const unsigned int TEXTURE_UPLOAD_PBOS = 3;
+// Byte caricati sulla GPU per frame da TextureUploadQueue e TextureStreamer insieme (almeno un caricamento per frame
+// anche se piu' grande)
+const size_t TEXTURE_UPLOAD_BUDGET_BYTES = 8 * 1024 * 1024;
+// Lato massimo dei layer dei texture array (RGB8): le immagini piu' grandi vengono ridotte
+const int TEXTURE_ARRAY_MAX_SIZE = 1024;
+// Se attivo i livelli di mip fini vengono caricati solo quando servono (TextureStreamer)
+const bool USE_TEXTURE_STREAMING = true;
+// Memoria video stimata concessa alle texture in streaming
+const size_t TEXTURE_STREAMING_BUDGET_BYTES = 256 * 1024 * 1024;
+// Lato massimo dei mip sempre residenti
+const int TEXTURE_STREAMING_COARSE_SIZE = 128;
+// Entro questa distanza dalla camera serve il livello 0, oltre si perde un livello a ogni raddoppio
+const float TEXTURE_STREAMING_DETAIL_DISTANCE = 30.0f;
+
+// COSTANTI PER L'AUDIO
+// -------------------------------------------------------------------------------------------
+// Comandi in coda verso il thread audio (potenza di due)
+const size_t AUDIO_COMMAND_QUEUE_SIZE = 256;
+// Periodo di aggiornamento degli stream musicali
+const int AUDIO_THREAD_PERIOD_MS = 5;
+// Durata di un sub-buffer degli stream di raudio (sampleRate / 30 frame): oltre questo intervallo tra due aggiornamenti il device resta senza dati
+const float AUDIO_UNDERRUN_GAP_SECONDS = 1.0f / 30.0f;
+
 // COSTANTI PER LA COLLEZIONE DELLE PAGINE
 // -------------------------------------------------------------------------------------------
 const float Z_V_MIN_PAGE = -0.35f;
@@ -84,6 +205,8 @@ const int TIME_SPAWN_SLENDER_FACTOR = 3;
 const float SPAWN_OFFSET_PER_PAGE = 10.0f;
 const float MAX_EXTERNAL_SPAWN_DISTANCE = 100.0f + SPAWN_OFFSET_PER_PAGE * (NUM_PAGES - 1);
 const float MAX_INTERNAL_SPAWN_DISTANCE = 20.0f + SPAWN_OFFSET_PER_PAGE * (NUM_PAGES - 1);
+// Lato delle celle della griglia dei punti di spawn: una query visita circa (2 * distanza esterna / lato)^2 celle
+const float SPAWN_GRID_CELL_SIZE = 2.0f * TREE_OFFSET;
 
 // SLENDER STRENGTH
 // -------------------------------------------------------------------------------------------
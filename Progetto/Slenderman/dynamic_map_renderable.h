@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 #include <unordered_set>
 #include <vector>
@@ -8,11 +10,16 @@
 
 #include "constants.h"
 #include "light_utils.h"
+#include "map_random.h"
 #include "model_cache.h"
+#include "occlusion_culler.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
 
+const glm::vec3 GRASS_SCALE = glm::vec3(0.015f, 0.01f, 0.015f);
+
 enum class DynamicEntity {
     tree,
     grass
@@ -21,34 +28,96 @@ enum class DynamicEntity {
 class DynamicMapRenderable : public InstancedModelRenderable {
 private:
     const DynamicEntity _entity;
-    const unordered_set<int> _tabooIndices;
+    unordered_set<int> _tabooIndices;
+    unsigned int _seed = 0;
+    vector<int> _visibleVAOIndexes;
+    // Estensione di un'istanza attorno alla sua posizione, per qualunque rotazione attorno a Y
+    CullBounds _instanceBounds;
+
+    void _initInstanceBounds(const glm::vec3& scale);
+    CullBounds _chunkBounds(const int vaoIndex, const float offset, const int quadSide, const int vaoObjectSide) const;
+    // Scarta i chunk nascosti dalla profondita' dei frame precedenti
+    void _cullOccludedChunks(const float offset, const int quadSide, const int vaoObjectSide);
 
     vector<int> getVaoIndexesFromCamera(const Camera& camera, const float offset, const int quadSide, const int vaoObjectSide) const;
-    void renderDynamicMap(const vector<int>& VAOIndexes, const int quadSide, const int vaoObjectSide) const;
+    vector<int> getNearVaoIndexes(const Camera& camera, const float maxDistance, const float offset, const int quadSide, const int vaoObjectSide) const;
+    void renderDynamicMap(const vector<int>& VAOIndexes, const Camera& camera, const float offset, const int quadSide, const int vaoObjectSide) const;
+    void renderProceduralMap(const vector<int>& VAOIndexes, const Camera& camera, const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scale) const;
 
 public:
-    DynamicMapRenderable(const DynamicEntity entity, const unordered_set<int> tabooIndices = { });
+    DynamicMapRenderable(const DynamicEntity entity, const uint32_t mapSeed, const unordered_set<int> tabooIndices = { });
+
+    // AABB degli alberi raggruppati per chunk, compresi quelli dei chunk nascosti
+    std::vector<std::vector<aabb*>> toChunkAABBs() const;
+
+    // I chunk esclusi possono cambiare a ogni partita senza rigenerare le istanze
+    inline void setTabooIndices(const unordered_set<int>& tabooIndices) { _tabooIndices = tabooIndices; }
 
-    inline std::vector<aabb*> toAABBs() const;
+    static glm::vec2 chunkCenter(const int vaoIndex, const float offset, const int quadSide, const int vaoObjectSide);
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    static bool isChunkNear(const int vaoIndex, const Camera& camera, const float maxDistance, const float offset, const int quadSide, const int vaoObjectSide);
+
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
-DynamicMapRenderable::DynamicMapRenderable(const DynamicEntity entity, const unordered_set<int> tabooIndices) : _entity(entity), _tabooIndices(tabooIndices) {
+DynamicMapRenderable::DynamicMapRenderable(const DynamicEntity entity, const uint32_t mapSeed, const unordered_set<int> tabooIndices) : _entity(entity), _tabooIndices(tabooIndices) {
     switch (_entity) {
     case DynamicEntity::tree:
         _model = ModelCache::getInstance().findModel(EModel::tree);
         _shader = ShaderCache::getInstance().findShader(EShader::tree);
-        _initUsingDynamicMapAlgorithm(TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE, TREE_OFFSET, glm::vec3(0.08f, 0.08f, 0.08f), false, tabooIndices);
+        _seed = MapRandom::seedFor(mapSeed, EMapStream::tree);
+        _initUsingDynamicMapAlgorithm(_seed, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE, TREE_OFFSET, glm::vec3(0.08f, 0.08f, 0.08f), false, tabooIndices);
+        _initInstanceBounds(glm::vec3(0.08f, 0.08f, 0.08f));
         break;
     case DynamicEntity::grass:
         _model = ModelCache::getInstance().findModel(EModel::grass);
         _shader = ShaderCache::getInstance().findShader(EShader::grass);
-        _initUsingDynamicMapAlgorithm(GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS, GRASS_OFFSET, glm::vec3(0.015f, 0.01f, 0.015f), true);
+        // Con lo stesso seed l'erba calcolata sulla CPU coincide con quella procedurale
+        _seed = MapRandom::seedFor(mapSeed, EMapStream::grass);
+        if (!PROCEDURAL_GRASS)
+            _initUsingDynamicMapAlgorithm(_seed, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS, GRASS_OFFSET, GRASS_SCALE, true);
+        // Anche l'erba procedurale, che non ha istanze sulla CPU
+        _initInstanceBounds(GRASS_SCALE);
         break;
     }
 }
 
+void DynamicMapRenderable::_initInstanceBounds(const glm::vec3& scale) {
+    CullBounds model = CullBounds::fromModel(*_model);
+    float radius = std::max(std::max(std::abs(model.min.x), std::abs(model.max.x)) * scale.x, std::max(std::abs(model.min.z), std::abs(model.max.z)) * scale.z);
+    radius *= sqrt(2.0f);
+
+    _instanceBounds.min = glm::vec3(-radius, model.min.y * scale.y, -radius);
+    _instanceBounds.max = glm::vec3(radius, model.max.y * scale.y, radius);
+}
+
+CullBounds DynamicMapRenderable::_chunkBounds(const int vaoIndex, const float offset, const int quadSide, const int vaoObjectSide) const {
+    // Le istanze distano al massimo mezzo chunk dal centro, piu' l'offset casuale dell'erba
+    glm::vec2 center = chunkCenter(vaoIndex, offset, quadSide, vaoObjectSide);
+    float halfSide = (vaoObjectSide + 1) * offset / 2;
+
+    // Stessa altezza delle istanze di _initUsingDynamicMapAlgorithm e grass_procedural.vs
+    CullBounds bounds;
+    bounds.min = glm::vec3(center.x - halfSide, -4.0f, center.y - halfSide) + _instanceBounds.min;
+    bounds.max = glm::vec3(center.x + halfSide, -4.0f, center.y + halfSide) + _instanceBounds.max;
+    return bounds;
+}
+
+void DynamicMapRenderable::_cullOccludedChunks(const float offset, const int quadSide, const int vaoObjectSide) {
+    if (!USE_OCCLUSION_CULLING)
+        return;
+
+    int numVAO = (quadSide / vaoObjectSide) * (quadSide / vaoObjectSide);
+    OcclusionCuller& culler = OcclusionCuller::getInstance();
+    _visibleVAOIndexes.erase(std::remove_if(_visibleVAOIndexes.begin(), _visibleVAOIndexes.end(), [&](int vaoIndex) {
+        if (vaoIndex < 0 || vaoIndex >= numVAO || _tabooIndices.find(vaoIndex) != _tabooIndices.end())
+            return false;
+        return !culler.isVisible(_chunkBounds(vaoIndex, offset, quadSide, vaoObjectSide), EOcclusionGroup::chunk);
+    }), _visibleVAOIndexes.end());
+}
+
 vector<int> DynamicMapRenderable::getVaoIndexesFromCamera(const Camera& camera, const float offset, const int quadSide, const int vaoObjectSide) const {
     vector<int> result;
 
@@ -81,60 +150,163 @@ vector<int> DynamicMapRenderable::getVaoIndexesFromCamera(const Camera& camera,
     return result;
 }
 
-void DynamicMapRenderable::renderDynamicMap(const vector<int>& VAOIndexes, const int quadSide, const int vaoObjectSide) const {
+vector<int> DynamicMapRenderable::getNearVaoIndexes(const Camera& camera, const float maxDistance, const float offset, const int quadSide, const int vaoObjectSide) const {
+    vector<int> result;
+
+    int numVAOForSide = quadSide / vaoObjectSide;
+    float chunkSide = vaoObjectSide * offset;
+    int xIndex = floor((camera.Position.x + (offset * quadSide / 2) + offset / 2) / chunkSide);
+    int zIndex = floor((camera.Position.z + (offset * quadSide / 2) + offset / 2) / chunkSide);
+    int range = ceil(maxDistance / chunkSide) + 1;
+
+    for (int i = std::max(0, xIndex - range); i <= std::min(numVAOForSide - 1, xIndex + range); i++) {
+        for (int j = std::max(0, zIndex - range); j <= std::min(numVAOForSide - 1, zIndex + range); j++) {
+            int vaoIndex = (i * numVAOForSide) + j;
+            if (isChunkNear(vaoIndex, camera, maxDistance, offset, quadSide, vaoObjectSide))
+                result.push_back(vaoIndex);
+        }
+    }
+
+    return result;
+}
+
+glm::vec2 DynamicMapRenderable::chunkCenter(const int vaoIndex, const float offset, const int quadSide, const int vaoObjectSide) {
+    int numVAOForSide = quadSide / vaoObjectSide;
+    int vaoI = vaoIndex / numVAOForSide;
+    int vaoJ = vaoIndex % numVAOForSide;
+
+    float x = ((vaoI * vaoObjectSide) + (vaoObjectSide - 1) / 2.0f - quadSide / 2) * offset;
+    float z = ((vaoJ * vaoObjectSide) + (vaoObjectSide - 1) / 2.0f - quadSide / 2) * offset;
+    return glm::vec2(x, z);
+}
+
+bool DynamicMapRenderable::isChunkNear(const int vaoIndex, const Camera& camera, const float maxDistance, const float offset, const int quadSide, const int vaoObjectSide) {
+    glm::vec2 center = chunkCenter(vaoIndex, offset, quadSide, vaoObjectSide);
+    return glm::distance(center, glm::vec2(camera.Position.x, camera.Position.z)) <= maxDistance;
+}
+
+void DynamicMapRenderable::renderDynamicMap(const vector<int>& VAOIndexes, const Camera& camera, const float offset, const int quadSide, const int vaoObjectSide) const {
     unsigned int numVAO = (quadSide / vaoObjectSide) * (quadSide / vaoObjectSide);
     unsigned int numElementForVAO = (quadSide * quadSide) / numVAO;
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    glm::vec2 cameraPosition(camera.Position.x, camera.Position.z);
 
     for (unsigned int k = 0; k < VAOIndexes.size(); k++) {
         int vaoIndex = std::max(VAOIndexes[k], 0);
         if (_tabooIndices.find(vaoIndex) != _tabooIndices.end())
             continue;
+        // Il dettaglio delle texture segue il chunk piu' vicino che le usa
+        float distance = glm::distance(chunkCenter(vaoIndex, offset, quadSide, vaoObjectSide), cameraPosition);
         for (unsigned int i = 0; i < _model->meshes.size(); i++) {
             if (vaoIndex >= _model->meshes[i].VAOs.size())
                 continue;
             for (unsigned int j = 0; j < _model->meshes[i].textures.size(); j++) {
-                glActiveTexture(GL_TEXTURE0 + j);
                 string name = _model->meshes[i].textures[j].type;
                 glUniform1i(glGetUniformLocation(_shader->ID, (name + std::to_string(j + 1)).c_str()), j);
-                glBindTexture(GL_TEXTURE_2D, _model->meshes[i].textures[j].id);
+                stateCache.bindTexture(j, _model->meshes[i].textures[j].id);
+                TextureStreamer::getInstance().touch(_model->meshes[i].textures[j].id, distance);
             }
-            glBindVertexArray(_model->meshes[i].VAOs[vaoIndex]);
+            stateCache.bindVertexArray(_model->meshes[i].VAOs[vaoIndex]);
             glDrawElementsInstanced(GL_TRIANGLES, _model->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, numElementForVAO);
-            glBindVertexArray(0);
         }
     }
 }
 
-std::vector<aabb*> DynamicMapRenderable::toAABBs() const {
+void DynamicMapRenderable::renderProceduralMap(const vector<int>& VAOIndexes, const Camera& camera, const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scale) const {
+    int numVAOForSide = quadSide / vaoObjectSide;
+    int numVAO = numVAOForSide * numVAOForSide;
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    glm::vec2 cameraPosition(camera.Position.x, camera.Position.z);
+
+    _shader->setInt("vaoObjectSide", vaoObjectSide);
+    _shader->setInt("quadSide", quadSide);
+    _shader->setFloat("offset", offset);
+    _shader->setInt("seed", static_cast<int>(_seed));
+    _shader->setVec3("scale", scale);
+
+    for (unsigned int k = 0; k < VAOIndexes.size(); k++) {
+        int vaoIndex = VAOIndexes[k];
+        if (vaoIndex < 0 || vaoIndex >= numVAO || _tabooIndices.find(vaoIndex) != _tabooIndices.end())
+            continue;
+
+        // Le istanze del chunk sono ricavate nello shader da gl_InstanceID e dall'origine del chunk
+        int vaoI = vaoIndex / numVAOForSide;
+        int vaoJ = vaoIndex % numVAOForSide;
+        glUniform2i(glGetUniformLocation(_shader->ID, "chunkOrigin"), vaoI * vaoObjectSide, vaoJ * vaoObjectSide);
+        float distance = glm::distance(chunkCenter(vaoIndex, offset, quadSide, vaoObjectSide), cameraPosition);
+
+        for (unsigned int i = 0; i < _model->meshes.size(); i++) {
+            for (unsigned int j = 0; j < _model->meshes[i].textures.size(); j++) {
+                string name = _model->meshes[i].textures[j].type;
+                glUniform1i(glGetUniformLocation(_shader->ID, (name + std::to_string(j + 1)).c_str()), j);
+                stateCache.bindTexture(j, _model->meshes[i].textures[j].id);
+                TextureStreamer::getInstance().touch(_model->meshes[i].textures[j].id, distance);
+            }
+            stateCache.bindVertexArray(_model->meshes[i].VAO);
+            glDrawElementsInstanced(GL_TRIANGLES, _model->meshes[i].indices.size(), GL_UNSIGNED_INT, 0, vaoObjectSide * vaoObjectSide);
+        }
+    }
+}
+
+std::vector<std::vector<aabb*>> DynamicMapRenderable::toChunkAABBs() const {
     if (_entity == DynamicEntity::grass)
         throw std::runtime_error("Cannot compute grass AABBs");
 
-    std::vector<aabb*> result;
-    for (auto transform : _transforms) {
-        auto aabbs = aabb::fromCompoundModel(*(_model), { glm::vec3(18.0f, 0.0f, -31.0f), glm::vec3(-246.0f, 0.0f, 280.0f), glm::vec3(59.0f, 0.0f, 311.0f) }, transform);
-        result.insert(result.end(), aabbs.begin(), aabbs.end());
+    int numVAOForSide = TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE;
+    std::vector<std::vector<aabb*>> result(numVAOForSide * numVAOForSide);
+    for (const auto& instance : _instances) {
+        // Gli alberi non hanno offset casuale, l'indice della griglia si ricava dalla traslazione
+        int i = static_cast<int>(round(instance.position.x / TREE_OFFSET)) + TREE_QUAD_SIDE / 2;
+        int j = static_cast<int>(round(instance.position.z / TREE_OFFSET)) + TREE_QUAD_SIDE / 2;
+        int vaoIndex = ((i / VAO_OBJECTS_SIDE_TREE) * numVAOForSide) + (j / VAO_OBJECTS_SIDE_TREE);
+
+        auto aabbs = aabb::fromCompoundModel(*(_model), { glm::vec3(18.0f, 0.0f, -31.0f), glm::vec3(-246.0f, 0.0f, 280.0f), glm::vec3(59.0f, 0.0f, 311.0f) }, instance.toMatrix(_scaleAxes));
+        result[vaoIndex].insert(result[vaoIndex].end(), aabbs.begin(), aabbs.end());
     }
 
     return result;
 }
 
-void DynamicMapRenderable::render(const Camera& camera, const LightUtils& lightUtils) {
-    lightUtils.initLightShader(_shader, camera);
+void DynamicMapRenderable::submit(RenderQueue& queue, const Camera& camera) {
+    switch (_entity) {
+    case DynamicEntity::tree:
+        // Con gli impostor attivi la geometria completa viene disegnata solo per i chunk vicini
+        if (USE_TREE_IMPOSTORS)
+            _visibleVAOIndexes = getNearVaoIndexes(camera, IMPOSTOR_DISTANCE, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
+        else
+            _visibleVAOIndexes = getVaoIndexesFromCamera(camera, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
+        _cullOccludedChunks(TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
+        break;
+    case DynamicEntity::grass:
+        _visibleVAOIndexes = getVaoIndexesFromCamera(camera, GRASS_OFFSET, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS);
+        _cullOccludedChunks(GRASS_OFFSET, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS);
+        break;
+    }
+
+    if (_visibleVAOIndexes.empty())
+        return;
 
-    _shader->use();
-    _shader->setMat4("projection", camera.GetProjection());
-    _shader->setMat4("view", camera.GetViewMatrix());
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.usesLights = true;
+    queue.submit(packet);
+}
+
+void DynamicMapRenderable::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
     _shader->setFloat("alphaValue", 0.4f);
+    _shader->setVec3("scaleAxes", _scaleAxes);
 
-    vector<int> VAOIndexes;
     switch (_entity) {
     case DynamicEntity::tree:
-        VAOIndexes = getVaoIndexesFromCamera(camera, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
-        renderDynamicMap(VAOIndexes, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
+        renderDynamicMap(_visibleVAOIndexes, camera, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
         break;
     case DynamicEntity::grass:
-        VAOIndexes = getVaoIndexesFromCamera(camera, GRASS_OFFSET, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS);
-        renderDynamicMap(VAOIndexes, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS);
+        if (PROCEDURAL_GRASS)
+            renderProceduralMap(_visibleVAOIndexes, camera, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS, GRASS_OFFSET, GRASS_SCALE);
+        else
+            renderDynamicMap(_visibleVAOIndexes, camera, GRASS_OFFSET, GRASS_QUAD_SIDE, VAO_OBJECTS_SIDE_GRASS);
         break;
     }
-}
\ No newline at end of file
+}
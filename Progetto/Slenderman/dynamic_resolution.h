@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "constants.h"
+#include "gl_resource.h"
+
+// Render target della scena 3D con risoluzione adattiva.
+// Il colore e il depth/stencil sono allocati una volta a risoluzione piena: si disegna solo nella porzione
+// (scala * schermo) e glBlitFramebuffer la riporta a risoluzione nativa prima degli overlay.
+// La scala segue il tempo GPU misurato con query GL_TIME_ELAPSED, lette con qualche frame di ritardo per non bloccare
+class DynamicResolution {
+private:
+    GLFramebuffer _framebuffer;
+    GLTexture _colorTexture;
+    GLRenderbuffer _depthStencilRBO;
+    int _width = 0;
+    int _height = 0;
+
+    unsigned int _queries[DYNAMIC_RESOLUTION_QUERIES] = {};
+    bool _queryPending[DYNAMIC_RESOLUTION_QUERIES] = {};
+    unsigned int _queryIndex = 0;
+
+    float _scale = 1.0f;
+    float _gpuTime = 0.0f;
+
+    void _init();
+    void _readQueries();
+    void _updateScale(const float gpuTime);
+
+public:
+    // Collega il render target, imposta il viewport ridotto e avvia la misura del tempo GPU
+    void beginScene();
+
+    // Chiude la misura e copia la scena sul framebuffer di default a risoluzione nativa
+    void endScene();
+
+    inline float scale() const { return _scale; }
+    inline unsigned int framebuffer() const { return _framebuffer.id(); }
+    inline int viewportWidth() const { return static_cast<int>(_width * _scale); }
+    inline int viewportHeight() const { return static_cast<int>(_height * _scale); }
+    inline float gpuTime() const { return _gpuTime; }
+
+    void destroy();
+};
+
+void DynamicResolution::_init() {
+    _width = SCR_WIDTH;
+    _height = SCR_HEIGHT;
+
+    _framebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer.id());
+
+    _colorTexture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, _colorTexture.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, _width, _height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    _colorTexture.setBytes(GLResourceRegistry::textureBytes(_width, _height, 4));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture.id(), 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    _depthStencilRBO = GLRenderbuffer::create();
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthStencilRBO.id());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+    _depthStencilRBO.setBytes(GLResourceRegistry::textureBytes(_width, _height, 4));
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthStencilRBO.id());
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Dynamic resolution framebuffer is not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    glGenQueries(DYNAMIC_RESOLUTION_QUERIES, _queries);
+}
+
+void DynamicResolution::_readQueries() {
+    // Legge solo le query gia' concluse, la piu' vecchia e' quella che verra' riusata ora
+    for (unsigned int i = 0; i < DYNAMIC_RESOLUTION_QUERIES; i++) {
+        if (!_queryPending[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(_queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(_queries[i], GL_QUERY_RESULT, &elapsed);
+        _queryPending[i] = false;
+        _updateScale(static_cast<float>(elapsed) / 1000000.0f);
+    }
+}
+
+void DynamicResolution::_updateScale(const float gpuTime) {
+    _gpuTime = gpuTime;
+
+    // Il costo e' circa proporzionale ai pixel, cioe' al quadrato della scala
+    float target = _scale * sqrt(DYNAMIC_RESOLUTION_BUDGET_MS / std::max(gpuTime, 0.01f));
+    if (gpuTime > DYNAMIC_RESOLUTION_BUDGET_MS)
+        target = std::max(target, _scale - DYNAMIC_RESOLUTION_MAX_STEP);
+    else if (gpuTime < DYNAMIC_RESOLUTION_BUDGET_MS * DYNAMIC_RESOLUTION_HEADROOM)
+        target = std::min(target, _scale + DYNAMIC_RESOLUTION_MAX_STEP * 0.25f);
+    else
+        target = _scale;
+
+    // Gradini fissi per non cambiare risoluzione a ogni frame per rumore di misura
+    target = round(target / DYNAMIC_RESOLUTION_STEP) * DYNAMIC_RESOLUTION_STEP;
+    _scale = glm::clamp(target, DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f);
+}
+
+void DynamicResolution::beginScene() {
+    if (!_framebuffer)
+        _init();
+
+    _readQueries();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer.id());
+    glViewport(0, 0, static_cast<int>(_width * _scale), static_cast<int>(_height * _scale));
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // Se la query di questo slot non e' ancora pronta si salta la misura del frame
+    if (!_queryPending[_queryIndex])
+        glBeginQuery(GL_TIME_ELAPSED, _queries[_queryIndex]);
+}
+
+void DynamicResolution::endScene() {
+    if (!_queryPending[_queryIndex]) {
+        glEndQuery(GL_TIME_ELAPSED);
+        _queryPending[_queryIndex] = true;
+    }
+    _queryIndex = (_queryIndex + 1) % DYNAMIC_RESOLUTION_QUERIES;
+
+    int width = static_cast<int>(_width * _scale);
+    int height = static_cast<int>(_height * _scale);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer.id());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_COLOR_BUFFER_BIT, _scale < 1.0f ? GL_LINEAR : GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void DynamicResolution::destroy() {
+    if (!_framebuffer)
+        return;
+
+    glDeleteQueries(DYNAMIC_RESOLUTION_QUERIES, _queries);
+    _depthStencilRBO.reset();
+    _colorTexture.reset();
+    _framebuffer.reset();
+}
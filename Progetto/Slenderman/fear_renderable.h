@@ -3,6 +3,7 @@
 #include "GLFW/glfw3.h"
 
 #include "constants.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 
@@ -10,14 +11,17 @@ class FearRenderable : public VAORenderable {
 private:
     const glm::vec2 _kResolution = glm::vec2(SCR_WIDTH, SCR_HEIGHT);
     float& _fearFactor;
+    const double& _time;
 
 public:
-    FearRenderable(float& fearFactor);
+    FearRenderable(float& fearFactor, const double& time);
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
-FearRenderable::FearRenderable(float& fearFactor) : _fearFactor(fearFactor) {
+FearRenderable::FearRenderable(float& fearFactor, const double& time) : _fearFactor(fearFactor), _time(time) {
     _shader = ShaderCache::getInstance().findShader(EShader::fear);
 
     float vertices[] = {
@@ -34,9 +38,9 @@ FearRenderable::FearRenderable(float& fearFactor) : _fearFactor(fearFactor) {
 
     unsigned int VBO, VAO, EBO;
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    VAO = _glResources.vertexArray();
+    VBO = _glResources.buffer(sizeof(vertices));
+    EBO = _glResources.buffer(sizeof(indices));
 
     glBindVertexArray(VAO);
 
@@ -55,25 +59,29 @@ FearRenderable::FearRenderable(float& fearFactor) : _fearFactor(fearFactor) {
     _VAO = VAO;
 }
 
-void FearRenderable::render(const Camera& camera, const LightUtils& lightUtils) {
+void FearRenderable::submit(RenderQueue& queue, const Camera& camera) {
     if (_fearFactor - 0.05 < 0.0)
         return;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glEnable(GL_DEPTH_TEST);
+    DrawPacket packet;
+    packet.pass = ERenderPass::overlay;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.VAO = _VAO;
+    queue.submit(packet);
+}
 
-    glEnable(GL_BLEND);
+void FearRenderable::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    stateCache.enable(GL_DEPTH_TEST);
+    stateCache.enable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    _shader->use();
-    _shader->setFloat("time", glfwGetTime());
+
+    _shader->setFloat("time", static_cast<float>(_time));
     _shader->setVec2("resolution", _kResolution);
     _shader->setFloat("fearFactor", _fearFactor);
-    
-    glBindVertexArray(_VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
-    glBindVertexArray(0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
-    glDisable(GL_BLEND);
+    stateCache.disable(GL_BLEND);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "light_utils.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
@@ -9,30 +10,35 @@ class Floor : public VAORenderable {
 public:
     Floor();
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
 Floor::Floor() {
     _shader = ShaderCache::getInstance().findShader(EShader::floor);
-    _VAO = VAORenderable::_initRectVAO(2000.0f);
+    _VAO = _initRectVAO(2000.0f);
     _texture = TextureCache::getInstance().findTexture(ETexture::floor);
 
     glm::mat4 transform = glm::mat4(1.0f);
     transform = glm::translate(transform, glm::vec3(0.0f, -4.0f, 0.0f));
     _transform = transform;
+    _normalMatrix = _normalMatrixOf(_transform);
 }
 
-void Floor::render(const Camera& camera, const LightUtils& lightUtils) {
-    lightUtils.initLightShader(_shader, camera);
-    _shader->use();
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+void Floor::submit(RenderQueue& queue, const Camera& camera) {
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.texture = _texture;
+    packet.VAO = _VAO;
+    packet.usesLights = true;
+    queue.submit(packet);
+}
 
+void Floor::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
     _shader->setMat4("model", _transform);
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
-
-    glBindVertexArray(_VAO);
+    _shader->setMat3("normalMatrix", _normalMatrix);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
@@ -9,8 +9,7 @@ struct FpsManager {
 
     FpsManager() : previousTime(glfwGetTime()), fps(0), frameCount(0) {}
 
-    int getFps() {
-        double currentTime = glfwGetTime();
+    int getFps(const double currentTime) {
         double timeInterval = currentTime - previousTime;
 
         frameCount++;
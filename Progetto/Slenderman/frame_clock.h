@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cmath>
+
+#include <GLFW/glfw3.h>
+
+#include "constants.h"
+
+// Tempo del frame campionato una sola volta all'inizio del ciclo e passato a tutte le scene,
+// cosi' nessuno interroga glfwGetTime() per conto proprio durante il frame
+struct FrameClock {
+    double time = 0.0;
+    float deltaTime = 0.0f;
+    unsigned long long frameIndex = 0;
+    double replayTime = -1.0;
+
+    void tick();
+
+    // Sostituisce il delta dell'ultimo tick con quello di una registrazione: il tempo del frame diventa
+    // la somma dei delta riprodotti
+    void replay(const float recordedDeltaTime);
+};
+
+void FrameClock::tick() {
+    double now = glfwGetTime();
+    // Un frame molto lungo (caricamenti, finestra trascinata) non deve propagarsi come un unico delta
+    deltaTime = frameIndex == 0 ? 0.0f : static_cast<float>(fmin(now - time, MAX_FRAME_DELTA));
+    time = now;
+    frameIndex++;
+}
+
+void FrameClock::replay(const float recordedDeltaTime) {
+    // La riproduzione parte dall'istante del primo frame riprodotto
+    if (replayTime < 0.0)
+        replayTime = time;
+
+    replayTime += recordedDeltaTime;
+    deltaTime = recordedDeltaTime;
+    time = replayTime;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "camera.h"
+#include "gl_resource.h"
+
+// Punto di binding del blocco uniform FrameConstants, uguale per tutti i programmi
+const unsigned int FRAME_CONSTANTS_BINDING = 0;
+const char* FRAME_CONSTANTS_BLOCK = "FrameConstants";
+
+// Layout std140, deve corrispondere al blocco FrameConstants degli shader
+struct FrameConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    // Piani del frustum (normale verso l'interno, w = distanza): left, right, bottom, top, near, far
+    glm::vec4 frustumPlanes[6];
+    glm::vec4 cameraPosition;
+};
+
+// Costanti della camera calcolate una volta per frame e condivise tramite uniform buffer
+class FrameConstantsBuffer {
+private:
+    FrameConstantsBuffer() {}
+
+    GLBuffer _UBO;
+    FrameConstants _constants;
+
+    void _extractFrustumPlanes();
+
+public:
+    FrameConstantsBuffer(FrameConstantsBuffer const&) = delete;
+    void operator=(FrameConstantsBuffer const&) = delete;
+
+    static FrameConstantsBuffer& getInstance() {
+        static FrameConstantsBuffer instance;
+        return instance;
+    }
+
+    // Collega il blocco FrameConstants del programma al punto di binding condiviso
+    static void bindProgram(const unsigned int program);
+
+    // Ricalcola le costanti dalla camera e le carica nell'uniform buffer
+    void update(const Camera& camera);
+
+    inline const FrameConstants& constants() const { return _constants; }
+
+    void destroy();
+};
+
+void FrameConstantsBuffer::bindProgram(const unsigned int program) {
+    unsigned int blockIndex = glGetUniformBlockIndex(program, FRAME_CONSTANTS_BLOCK);
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, FRAME_CONSTANTS_BINDING);
+}
+
+void FrameConstantsBuffer::update(const Camera& camera) {
+    _constants.view = camera.GetViewMatrix();
+    _constants.projection = camera.GetProjection();
+    _constants.viewProjection = _constants.projection * _constants.view;
+    _constants.cameraPosition = glm::vec4(camera.Position, 1.0f);
+    _extractFrustumPlanes();
+
+    if (!_UBO) {
+        _UBO = GLBuffer::create();
+        glBindBuffer(GL_UNIFORM_BUFFER, _UBO.id());
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameConstants), NULL, GL_DYNAMIC_DRAW);
+        _UBO.setBytes(sizeof(FrameConstants));
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, _UBO.id());
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _UBO.id());
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameConstants), &_constants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameConstantsBuffer::_extractFrustumPlanes() {
+    // Metodo di Gribb-Hartmann sulle righe della matrice viewProjection
+    const glm::mat4& m = _constants.viewProjection;
+    glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    _constants.frustumPlanes[0] = row3 + row0;
+    _constants.frustumPlanes[1] = row3 - row0;
+    _constants.frustumPlanes[2] = row3 + row1;
+    _constants.frustumPlanes[3] = row3 - row1;
+    _constants.frustumPlanes[4] = row3 + row2;
+    _constants.frustumPlanes[5] = row3 - row2;
+
+    for (auto& plane : _constants.frustumPlanes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+void FrameConstantsBuffer::destroy() {
+    _UBO.reset();
+}
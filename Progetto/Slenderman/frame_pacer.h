@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "constants.h"
+
+struct FramePacingStats {
+    float p50 = 0.0f;           // millisecondi
+    float p99 = 0.0f;           // millisecondi
+    float latency = 0.0f;       // millisecondi, dal campionamento dell'input al completamento del frame sulla GPU
+    unsigned int lateFrames = 0;
+};
+
+// Limita il frame rate a FRAME_PACING_TARGET_FPS e il numero di frame accodati alla GPU.
+// L'attesa e' uno sleep fino a poco prima della scadenza seguito da uno spin-wait: il margine
+// si adatta al ritardo osservato dello sleep, che su Windows puo' superare il millisecondo
+class FramePacer {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    double _targetFrameTime;
+    Clock::time_point _frameStart;
+    Clock::time_point _inputTime;
+    bool _started = false;
+    double _spinMargin = FRAME_PACING_MIN_SPIN_MARGIN;
+
+    // Un fence per ogni frame in volo, con l'istante in cui e' stato campionato il suo input
+    GLsync _fences[FRAME_PACING_MAX_FRAMES_IN_FLIGHT] = {};
+    Clock::time_point _fenceInputTimes[FRAME_PACING_MAX_FRAMES_IN_FLIGHT];
+    unsigned int _fenceIndex = 0;
+
+    std::vector<float> _frameTimes;
+    std::vector<float> _sortedFrameTimes;
+    unsigned int _frameTimesNext = 0;
+    unsigned int _lateFrames = 0;
+    float _latency = 0.0f;
+
+    void _sleepUntil(const Clock::time_point& deadline);
+    void _waitForFence(const unsigned int index);
+    void _recordFrameTime(const float frameTime);
+    float _percentile(const float percentile);
+
+public:
+    FramePacer(const int targetFps = FRAME_PACING_TARGET_FPS);
+
+    // Da chiamare all'inizio del ciclo, subito prima di campionare l'input
+    void beginFrame();
+
+    // Da chiamare subito dopo glfwSwapBuffers
+    void endFrame();
+
+    FramePacingStats stats();
+
+    void destroy();
+};
+
+FramePacer::FramePacer(const int targetFps) : _targetFrameTime(targetFps > 0 ? 1.0 / targetFps : 0.0) {
+    _frameTimes.reserve(FRAME_PACING_HISTORY);
+    _sortedFrameTimes.reserve(FRAME_PACING_HISTORY);
+}
+
+void FramePacer::_sleepUntil(const Clock::time_point& deadline) {
+    Clock::time_point now = Clock::now();
+    double remaining = std::chrono::duration<double>(deadline - now).count();
+    if (remaining <= 0.0)
+        return;
+
+    if (remaining > _spinMargin) {
+        Clock::time_point wakeUp = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_spinMargin));
+        std::this_thread::sleep_until(wakeUp);
+
+        // Il margine segue il ritardo massimo recente dello sleep e torna lentamente verso il minimo
+        double oversleep = std::chrono::duration<double>(Clock::now() - wakeUp).count();
+        _spinMargin = std::max(FRAME_PACING_MIN_SPIN_MARGIN, std::max(oversleep * 1.25, _spinMargin * 0.99));
+    }
+
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+
+void FramePacer::_waitForFence(const unsigned int index) {
+    GLsync fence = _fences[index];
+    if (fence == 0)
+        return;
+
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (result == GL_TIMEOUT_EXPIRED)
+        result = glClientWaitSync(fence, 0, 1000000);
+
+    float latency = std::chrono::duration<float, std::milli>(Clock::now() - _fenceInputTimes[index]).count();
+    _latency = _latency == 0.0f ? latency : _latency * 0.9f + latency * 0.1f;
+
+    glDeleteSync(fence);
+    _fences[index] = 0;
+}
+
+void FramePacer::beginFrame() {
+    if (_started && _targetFrameTime > 0.0)
+        _sleepUntil(_frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_targetFrameTime)));
+
+    // Il frame che riusera' questo slot non parte finche' la GPU non ha finito quello di N frame fa
+    _waitForFence(_fenceIndex);
+
+    Clock::time_point now = Clock::now();
+    if (_started)
+        _recordFrameTime(std::chrono::duration<float, std::milli>(now - _frameStart).count());
+    _frameStart = now;
+    _inputTime = now;
+    _started = true;
+}
+
+void FramePacer::endFrame() {
+    _fences[_fenceIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _fenceInputTimes[_fenceIndex] = _inputTime;
+    _fenceIndex = (_fenceIndex + 1) % FRAME_PACING_MAX_FRAMES_IN_FLIGHT;
+}
+
+void FramePacer::_recordFrameTime(const float frameTime) {
+    if (_frameTimes.size() < FRAME_PACING_HISTORY)
+        _frameTimes.push_back(frameTime);
+    else
+        _frameTimes[_frameTimesNext] = frameTime;
+    _frameTimesNext = (_frameTimesNext + 1) % FRAME_PACING_HISTORY;
+
+    // Senza limite un frame e' in ritardo rispetto ai 60 fps
+    double budget = _targetFrameTime > 0.0 ? _targetFrameTime : 1.0 / 60.0;
+    if (frameTime > budget * 1000.0 * FRAME_PACING_LATE_FACTOR)
+        _lateFrames++;
+}
+
+float FramePacer::_percentile(const float percentile) {
+    if (_frameTimes.empty())
+        return 0.0f;
+
+    _sortedFrameTimes.assign(_frameTimes.begin(), _frameTimes.end());
+    size_t index = std::min(_sortedFrameTimes.size() - 1, static_cast<size_t>(percentile * _sortedFrameTimes.size()));
+    std::nth_element(_sortedFrameTimes.begin(), _sortedFrameTimes.begin() + index, _sortedFrameTimes.end());
+    return _sortedFrameTimes[index];
+}
+
+FramePacingStats FramePacer::stats() {
+    FramePacingStats stats;
+    stats.p50 = _percentile(0.5f);
+    stats.p99 = _percentile(0.99f);
+    stats.latency = _latency;
+    stats.lateFrames = _lateFrames;
+    return stats;
+}
+
+void FramePacer::destroy() {
+    for (unsigned int i = 0; i < FRAME_PACING_MAX_FRAMES_IN_FLIGHT; i++) {
+        if (_fences[i] != 0)
+            glDeleteSync(_fences[i]);
+        _fences[i] = 0;
+    }
+}
@@ -40,10 +40,8 @@ void FullsceenImage::_initImage() {
          1.0f,  1.0f,  1.0f, 0.0f
     };
 
-    unsigned int VAO;
-    unsigned int VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    unsigned int VAO = _glResources.vertexArray();
+    unsigned int VBO = _glResources.buffer(sizeof(vertices));
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), &vertices, GL_STATIC_DRAW);
@@ -62,6 +60,7 @@ void FullsceenImage::render(const Camera& camera, const LightUtils& lightUtils)
     _shader->use();
     glBindVertexArray(_VAO);
     glBindTexture(GL_TEXTURE_2D, _texture);
+    TextureStreamer::getInstance().touch(_texture);
     glDrawArrays(GL_TRIANGLES, 0, 6);
     glEnable(GL_DEPTH_TEST);
 }
\ No newline at end of file
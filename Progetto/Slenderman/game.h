@@ -4,12 +4,17 @@
 #include <GLFW/glfw3.h>
 
 #include "fps_manager.h"
+#include "frame_clock.h"
+#include "frame_pacer.h"
 #include "input_manager.h"
+#include "input_recorder.h"
 
 #include "audio_manager.h"
 #include "constants.h"
+#include "gl_resource.h"
 #include "model.h"
 #include "model_cache.h"
+#include "occlusion_culler.h"
 #include "raudio/raudio.h"
 #include "render_text.h"
 #include "scene/loading_scene.h"
@@ -17,17 +22,25 @@
 #include "menu_scene.h"
 #include "shader_m.h"
 #include "shader_cache.h"
+#include "static_geometry.h"
+#include "streaming_buffer.h"
 #include "texture_cache.h"
+#include "thread_pool.h"
+#include "world_cache.h"
 
 class Scene;
 
 class GameLoop {
 private:
     FpsManager _fpsManager;
+    FrameClock _clock;
+    FramePacer _framePacer;
 
     GLFWwindow* _window;
     SceneManager* _sceneManager;
 
+    double _startTime = -1.0;
+
     static Scene* _buildMenuScene(SceneManager* manager, GLFWwindow* window) {
         return new MenuScene(manager, window);
     }
@@ -42,6 +55,8 @@ private:
 
     void _renderFPS();
 
+    void _reportReplay();
+
 public:
     GameLoop(GLFWwindow* window) : _window(window) {}
 
@@ -54,6 +69,8 @@ public:
 
 void GameLoop::init() {
     AudioManager::getInstance().initAudio();
+    // Il font viene preparato una sola volta, le scene si limitano a usarlo
+    initRenderText(SCR_WIDTH, SCR_HEIGHT);
 
     _sceneManager = new SceneManager(_window);
 
@@ -71,26 +88,32 @@ void GameLoop::init() {
 }
 
 void GameLoop::process() {
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
-    int fps = 0;
-
     while (!glfwWindowShouldClose(_window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        // L'input si campiona dopo l'attesa del pacer, il piu' vicino possibile al rendering
+        _framePacer.beginFrame();
+        StreamingBuffer::getInstance().beginFrame();
+        glfwPollEvents();
+        _clock.tick();
+        if (_startTime < 0.0)
+            _startTime = glfwGetTime();
+        if (!InputManager::beginFrame(_clock)) {
+            _reportReplay();
+            glfwSetWindowShouldClose(_window, true);
+        }
 
         glClearColor(0.01f, 0.01f, 0.01f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
+        TextureUploadRing::getInstance().beginFrame();
+        TextureUploadQueue::getInstance().process();
+        _sceneManager->currentScene()->process(_clock);
+        // Dopo la scena: con la risoluzione dinamica il blit copre tutto il framebuffer di default
         _renderFPS();
+        TextureStreamer::getInstance().update();
 
-        _sceneManager->currentScene()->process(deltaTime);
-
+        StreamingBuffer::getInstance().endFrame();
         glfwSwapBuffers(_window);
-        glfwPollEvents();
-
-        AudioManager::getInstance().process();
+        _framePacer.endFrame();
     }
 }
 
@@ -99,16 +122,57 @@ void GameLoop::destroy() {
     delete _sceneManager->currentScene();
     delete _sceneManager;
 
+    WorldCache::getInstance().clear();
+    StaticGeometry::getInstance().clear();
     ModelCache::getInstance().clear();
     ShaderCache::getInstance().clear();
+    FrameConstantsBuffer::getInstance().destroy();
+    OcclusionCuller::getInstance().destroy();
+    _framePacer.destroy();
+    destroyRenderText();
+    StreamingBuffer::getInstance().destroy();
+    TextureUploadQueue::getInstance().destroy();
+    TextureUploadRing::getInstance().destroy();
+    TextureStreamer::getInstance().clear();
     TextureCache::getInstance().clear();
+    ThreadPool::getInstance().destroy();
 
     AudioManager::getInstance().destroy();
+    InputRecorder::getInstance().stop();
+
+    // Dopo le cache non deve restare nessun oggetto GL
+    if (DEBUG && GLResourceRegistry::getInstance().liveObjects() > 0) {
+        std::cout << "Leaked ";
+        GLResourceRegistry::getInstance().report(std::cout);
+    }
+}
+
+// Riassunto della riproduzione, da confrontare tra build diverse con la stessa registrazione
+void GameLoop::_reportReplay() {
+    InputRecorder& recorder = InputRecorder::getInstance();
+    double elapsed = glfwGetTime() - _startTime;
+    FramePacingStats stats = _framePacer.stats();
+
+    std::cout << "Replay finished: " << recorder.frames() << " frames in " << elapsed << "s ("
+        << (elapsed > 0.0 ? recorder.frames() / elapsed : 0.0) << " fps) p50: " << stats.p50 << "ms p99: " << stats.p99
+        << "ms late: " << stats.lateFrames << std::endl;
 }
 
 void GameLoop::_renderFPS() {
     std::stringstream ssfps;
-    ssfps << "fps: " << _fpsManager.getFps();
+    ssfps << "fps: " << _fpsManager.getFps(_clock.time);
     std::string fps_str = ssfps.str();
     RenderText(fps_str, SCR_WIDTH - 200.0f, SCR_HEIGHT - 50.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    if (DEBUG) {
+        FramePacingStats stats = _framePacer.stats();
+        std::stringstream sspacing;
+        sspacing << "p50: " << stats.p50 << "ms p99: " << stats.p99 << "ms late: " << stats.lateFrames << " lat: " << stats.latency << "ms";
+        RenderText(sspacing.str(), SCR_WIDTH - 600.0f, SCR_HEIGHT - 80.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+        AudioStats audio = AudioManager::getInstance().stats();
+        std::stringstream ssaudio;
+        ssaudio << "audio underruns: " << audio.underruns << " dropped: " << audio.droppedCommands << " gap: " << audio.maxUpdateGap * 1000.0f << "ms";
+        RenderText(ssaudio.str(), SCR_WIDTH - 600.0f, SCR_HEIGHT - 110.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,335 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "collision_solver.h"
+#include "constants.h"
+#include "frame_clock.h"
+#include "game_state.h"
+#include "page.h"
+#include "slender_manager.h"
+
+// Logica di gioco eseguita su un thread dedicato a passo fisso (1 / SIMULATION_TICK_RATE).
+// Il tempo reale trascorso si accumula e viene consumato a tick interi, al massimo SIMULATION_MAX_STEPS per risveglio.
+// Tutti i timer di gioco usano il tempo di simulazione.
+// Il thread principale invia l'input campionato e legge gli snapshot pubblicati.
+// In modalita' lockstep (registrazione e riproduzione dell'input) non c'e' un thread: la simulazione avanza dentro pushInput
+// con il delta del frame, cosi' i tick e l'input di ogni tick dipendono solo dai frame registrati
+class GameSimulation {
+private:
+    // Stato posseduto dal thread di simulazione
+    Camera _camera;
+    const CollisionSolver& _collisionSolver;
+    const SpawnPointGrid& _slendermanSpawnPoints;
+    SlenderManager _slenderManager;
+    glm::mat4 _slenderTransform = glm::mat4(1.0f);
+    // Generatore dello spawn: seed della partita e contatore delle estrazioni
+    const uint32_t _spawnSeed;
+    uint32_t _spawnDraw = 0;
+
+    std::vector<glm::vec3> _pagePOITranslations;
+    std::vector<bool> _pagesCollected;
+    int _framedPage = -1;
+    int _collectedPages = 0;
+    double _pageCollectedTime = 0.0;
+
+    float _fearFactor = 0.0f;
+    float _loseThreshold = 1.0f;
+    bool _lightOn = true;
+    bool _menuOpen = false;
+    bool _quitRequested = false;
+    EGameOutcome _outcome = EGameOutcome::playing;
+    std::vector<const aabb*> _testedAABBs;
+    std::vector<const aabb*> _intersectedAABBs;
+
+    const bool _lockstep;
+    double _accumulator = 0.0;
+    double _simulationTime = 0.0;
+    double _previousTime = 0.0;
+    double _previousEscMenuTime = 0.0;
+    double _lastPlayedFootstep = 0.0;
+
+    // Comunicazione con il thread principale
+    std::thread _thread;
+    std::atomic<bool> _running{ false };
+
+    std::mutex _inputMutex;
+    InputState _latestInput;
+    InputState _pendingInput;
+
+    std::mutex _eventsMutex;
+    std::vector<ESimEvent> _events;
+
+    SnapshotBuffer _snapshots;
+
+    void _run();
+    void _advance(const double elapsed, const double time);
+    void _tick(const float deltaTime, const InputState& input);
+    void _processInput(const float deltaTime, const InputState& input, const CollisionResult& collisionResult);
+    void _findFramedPage();
+    void _publish(const double time);
+    void _emit(const ESimEvent event);
+
+    InputState _consumeInput();
+
+public:
+    GameSimulation(const Camera& camera, const CollisionSolver& collisionSolver, const SpawnPointGrid& slendermanSpawnPoints, const std::vector<Page*>& pages, const glm::mat4& slenderTransform, const uint32_t mapSeed, const double time, const bool lockstep = false);
+
+    ~GameSimulation() { stop(); }
+
+    void start();
+
+    void stop();
+
+    void pushInput(const InputState& input, const FrameClock& clock);
+
+    void drainEvents(std::vector<ESimEvent>& events);
+
+    inline void readSnapshots(GameSnapshot& previous, GameSnapshot& current) const { _snapshots.read(previous, current); }
+};
+
+GameSimulation::GameSimulation(const Camera& camera, const CollisionSolver& collisionSolver, const SpawnPointGrid& slendermanSpawnPoints, const std::vector<Page*>& pages, const glm::mat4& slenderTransform, const uint32_t mapSeed, const double time, const bool lockstep)
+    : _camera(camera), _collisionSolver(collisionSolver), _slendermanSpawnPoints(slendermanSpawnPoints), _slenderTransform(slenderTransform),
+    _spawnSeed(MapRandom::seedFor(mapSeed, EMapStream::spawn)), _lockstep(lockstep) {
+    for (auto page : pages)
+        _pagePOITranslations.push_back(page->getRelatedPOITranslation());
+    _pagesCollected.resize(pages.size(), false);
+
+    _latestInput.yaw = _camera.Yaw;
+    _latestInput.pitch = _camera.Pitch;
+    _pendingInput = _latestInput;
+
+    // Entrambi i buffer partono dallo stato iniziale, al tempo del FrameClock
+    _publish(time);
+    _publish(time);
+}
+
+void GameSimulation::start() {
+    if (_running)
+        return;
+
+    _running = true;
+    if (!_lockstep)
+        _thread = std::thread(&GameSimulation::_run, this);
+}
+
+void GameSimulation::stop() {
+    _running = false;
+    if (_thread.joinable())
+        _thread.join();
+}
+
+void GameSimulation::pushInput(const InputState& input, const FrameClock& clock) {
+    {
+        std::lock_guard<std::mutex> lock(_inputMutex);
+        _latestInput = input;
+        _pendingInput.merge(input);
+    }
+
+    if (_lockstep && _running)
+        _advance(clock.deltaTime, clock.time);
+}
+
+InputState GameSimulation::_consumeInput() {
+    std::lock_guard<std::mutex> lock(_inputMutex);
+    InputState input = _pendingInput;
+    _pendingInput = _latestInput;
+    return input;
+}
+
+void GameSimulation::drainEvents(std::vector<ESimEvent>& events) {
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    events.insert(events.end(), _events.begin(), _events.end());
+    _events.clear();
+}
+
+void GameSimulation::_emit(const ESimEvent event) {
+    std::lock_guard<std::mutex> lock(_eventsMutex);
+    _events.push_back(event);
+}
+
+void GameSimulation::_run() {
+    const double tick = 1.0 / SIMULATION_TICK_RATE;
+    auto previous = std::chrono::steady_clock::now();
+
+    while (_running) {
+        auto now = std::chrono::steady_clock::now();
+        // Istante reale di pubblicazione (stesso orologio di FrameClock) per l'interpolazione
+        _advance(std::chrono::duration<double>(now - previous).count(), glfwGetTime());
+        previous = now;
+
+        std::this_thread::sleep_until(now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(tick - _accumulator)));
+    }
+}
+
+void GameSimulation::_advance(const double elapsed, const double time) {
+    const double tick = 1.0 / SIMULATION_TICK_RATE;
+    _accumulator += elapsed;
+
+    int steps = 0;
+    while (_accumulator >= tick && steps < SIMULATION_MAX_STEPS) {
+        _tick(static_cast<float>(tick), _consumeInput());
+        _simulationTime += tick;
+        _accumulator -= tick;
+        steps++;
+    }
+
+    // Dopo uno stallo lungo si riparte dal tempo attuale invece di rincorrere i tick persi
+    if (steps == SIMULATION_MAX_STEPS)
+        _accumulator = fmod(_accumulator, tick);
+
+    if (steps > 0)
+        _publish(time);
+}
+
+void GameSimulation::_tick(const float deltaTime, const InputState& input) {
+    _camera.SetOrientation(input.yaw, input.pitch);
+
+    if (_outcome != EGameOutcome::playing || _quitRequested)
+        return;
+
+    if (_collectedPages == NUM_PAGES) {
+        _outcome = EGameOutcome::win;
+        return;
+    }
+
+    if (_fearFactor >= _loseThreshold) {
+        _outcome = EGameOutcome::lose;
+        return;
+    }
+
+    // Con il passo fisso la distanza di controllo non dipende dal frame rate
+    CollisionResult collisionResult = _collisionSolver.checkCollisionWithRegisteredAABBs(_camera, fmaxf(5.0f, (deltaTime * _camera.MovementSpeed) + 0.5f));
+    _processInput(deltaTime, input, collisionResult);
+    if (DEBUG) {
+        _testedAABBs = std::move(collisionResult.testedAABBs);
+        _intersectedAABBs = std::move(collisionResult.intersectedAABBs);
+    }
+
+    if (_quitRequested)
+        return;
+
+    if (_menuOpen)
+        return;
+
+    _findFramedPage();
+
+    _slenderTransform = _slenderManager.updateSlenderman(_camera, _slendermanSpawnPoints, _collectedPages, _simulationTime, _spawnSeed, _spawnDraw);
+
+    _fearFactor = _slenderManager.updateFearFactor(_camera, _fearFactor, deltaTime);
+}
+
+void GameSimulation::_processInput(const float deltaTime, const InputState& input, const CollisionResult& collisionResult) {
+    if (_menuOpen && input.quitToMenu) {
+        _quitRequested = true;
+        return;
+    }
+
+    if (input.escape) {
+        if (_simulationTime - _previousEscMenuTime > 0.3f) {
+            _previousEscMenuTime = _simulationTime;
+            _menuOpen = !_menuOpen;
+        }
+    }
+
+    if (_menuOpen) {
+        return;
+    }
+
+    bool superSaiyan = input.sprint && DEBUG;
+    float speedIncrement = superSaiyan ? 150.0f : 0.0f;
+
+    bool shouldPlayFootstep = false;
+
+    if (input.forward && (!collisionResult.n || superSaiyan)) {
+        shouldPlayFootstep = true;
+        _camera.ProcessKeyboard(FORWARD, deltaTime, speedIncrement);
+    }
+    if (input.backward && (!collisionResult.s || superSaiyan)) {
+        shouldPlayFootstep = true;
+        _camera.ProcessKeyboard(BACKWARD, deltaTime, speedIncrement);
+    }
+    if (input.left && (!collisionResult.w || superSaiyan)) {
+        shouldPlayFootstep = true;
+        _camera.ProcessKeyboard(LEFT, deltaTime, speedIncrement);
+    }
+    if (input.right && (!collisionResult.e || superSaiyan)) {
+        shouldPlayFootstep = true;
+        _camera.ProcessKeyboard(RIGHT, deltaTime, speedIncrement);
+    }
+
+    // Il thread principale riproduce il passo solo se il precedente e' terminato
+    if (_simulationTime - _lastPlayedFootstep > 0.8f && shouldPlayFootstep) {
+        _emit(ESimEvent::footstep);
+        _lastPlayedFootstep = _simulationTime;
+    }
+
+    if (input.flashlight) {
+        if (_simulationTime - _previousTime > 0.3f) {
+            _previousTime = _simulationTime;
+            _lightOn = !_lightOn;
+        }
+    }
+
+    if (input.collect && _framedPage >= 0 && !_pagesCollected[_framedPage]) {
+        _pagesCollected[_framedPage] = true;
+        _collectedPages++;
+        _loseThreshold = 1.0f - _collectedPages * THRESHOLD_OFFSET;
+        _pageCollectedTime = _simulationTime;
+        _emit(ESimEvent::pageCollected);
+    }
+}
+
+void GameSimulation::_findFramedPage() {
+    for (size_t i = 0; i < _pagePOITranslations.size(); i++) {
+        const glm::vec3& translationVec = _pagePOITranslations[i];
+        float streetlampX = translationVec.x + STREETLIGHT_POI_OFFSET;
+        float streetlightZ = translationVec.z + STREETLIGHT_POI_OFFSET;
+
+        float streetlightDistance = sqrt(pow(streetlampX - _camera.Position.x, 2) + pow(streetlightZ - _camera.Position.z, 2));
+        bool collectPosition = (_camera.Position.x > streetlampX && streetlightDistance <= PAGE_SELECTION_DISTANCE);
+
+        float z = streetlightZ - _camera.Position.z;
+        float alpha = z / streetlightDistance;
+        bool collectVision = (_camera.Front.x > X_V_MIN_PAGE && _camera.Front.x < X_V_MAX_PAGE)
+            && (_camera.Front.y > Y_V_MIN_PAGE && _camera.Front.y < Y_V_MAX_PAGE)
+            && (_camera.Front.z > (Z_V_MIN_PAGE + alpha) && _camera.Front.z < (Z_V_MAX_PAGE + alpha))
+            && (abs(alpha) < MAX_ANGLE_PAGE);
+
+        if (collectPosition && collectVision) {
+            _framedPage = i;
+            return;
+        }
+    }
+
+    _framedPage = -1;
+}
+
+void GameSimulation::_publish(const double time) {
+    GameSnapshot snapshot;
+    snapshot.time = time;
+    snapshot.simulationTime = _simulationTime;
+    snapshot.cameraPosition = _camera.Position;
+    snapshot.slenderTransform = _slenderTransform;
+    snapshot.fearFactor = _fearFactor;
+    snapshot.pagesCollected = _pagesCollected;
+    snapshot.framedPage = _framedPage;
+    snapshot.collectedPages = _collectedPages;
+    snapshot.pageCollectedTime = _pageCollectedTime;
+    snapshot.lightOn = _lightOn;
+    snapshot.menuOpen = _menuOpen;
+    snapshot.quitRequested = _quitRequested;
+    snapshot.outcome = _outcome;
+    snapshot.testedAABBs = _testedAABBs;
+    snapshot.intersectedAABBs = _intersectedAABBs;
+    _snapshots.publish(snapshot);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class aabb;
+
+// Stato dell'input campionato dal thread principale (GLFW va interrogato solo da li')
+struct InputState {
+    bool forward = false;
+    bool backward = false;
+    bool left = false;
+    bool right = false;
+    bool sprint = false;
+    bool flashlight = false;
+    bool escape = false;
+    bool quitToMenu = false;
+    bool collect = false;
+
+    // L'orientamento segue il mouse sul thread principale, la simulazione lo usa per muoversi
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+
+    // Unisce gli eventi di due campionamenti, cosi' una pressione breve tra due tick non va persa
+    void merge(const InputState& other);
+};
+
+enum class EGameOutcome {
+    playing,
+    win,
+    lose
+};
+
+// Eventi prodotti dalla simulazione e consumati dal thread principale (audio, messaggi)
+enum class ESimEvent {
+    footstep,
+    pageCollected
+};
+
+// Fotografia immutabile dello stato di gioco pubblicata a ogni tick
+struct GameSnapshot {
+    double time = 0.0;
+    double simulationTime = 0.0;
+
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::mat4 slenderTransform = glm::mat4(1.0f);
+    float fearFactor = 0.0f;
+
+    std::vector<bool> pagesCollected;
+    int framedPage = -1;
+    int collectedPages = 0;
+    double pageCollectedTime = 0.0;   // tempo di simulazione
+
+    bool lightOn = true;
+    bool menuOpen = false;
+    bool quitRequested = false;
+    EGameOutcome outcome = EGameOutcome::playing;
+
+    // AABB vicini alla camera controllati nell'ultimo tick e quelli intersecati (debug)
+    std::vector<const aabb*> testedAABBs;
+    std::vector<const aabb*> intersectedAABBs;
+};
+
+// Doppio buffer degli snapshot: la simulazione scrive l'ultimo, il rendering legge gli ultimi due per interpolare
+class SnapshotBuffer {
+private:
+    mutable std::mutex _mutex;
+    GameSnapshot _snapshots[2];
+    int _current = 0;
+
+public:
+    void publish(const GameSnapshot& snapshot);
+
+    void read(GameSnapshot& previous, GameSnapshot& current) const;
+};
+
+void InputState::merge(const InputState& other) {
+    forward = forward || other.forward;
+    backward = backward || other.backward;
+    left = left || other.left;
+    right = right || other.right;
+    sprint = sprint || other.sprint;
+    flashlight = flashlight || other.flashlight;
+    escape = escape || other.escape;
+    quitToMenu = quitToMenu || other.quitToMenu;
+    collect = collect || other.collect;
+
+    yaw = other.yaw;
+    pitch = other.pitch;
+}
+
+void SnapshotBuffer::publish(const GameSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _current = 1 - _current;
+    _snapshots[_current] = snapshot;
+}
+
+void SnapshotBuffer::read(GameSnapshot& previous, GameSnapshot& current) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    previous = _snapshots[1 - _current];
+    current = _snapshots[_current];
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+enum class EGLResource {
+    buffer,
+    vertexArray,
+    texture,
+    renderbuffer,
+    framebuffer,
+    program
+};
+
+const int GL_RESOURCE_TYPES = 6;
+
+struct GLResourceStats {
+    unsigned int live = 0;
+    unsigned long long created = 0;
+    unsigned long long deleted = 0;
+    size_t bytes = 0;           // stimati: dimensione dei dati caricati, senza padding ne' allineamenti del driver
+};
+
+// Registro degli oggetti GL vivi per categoria, con una stima dei byte occupati.
+// Tutte le chiamate avvengono sul thread GL: gli id sono validi solo nel contesto corrente
+class GLResourceRegistry {
+private:
+    GLResourceRegistry() {}
+
+    GLResourceStats _stats[GL_RESOURCE_TYPES];
+    // { (tipo, id) - byte stimati }
+    std::unordered_map<uint64_t, size_t> _objects;
+
+    static inline uint64_t _key(const EGLResource type, const unsigned int id) { return (static_cast<uint64_t>(type) << 32) | id; }
+
+public:
+    GLResourceRegistry(GLResourceRegistry const&) = delete;
+    void operator=(GLResourceRegistry const&) = delete;
+
+    static GLResourceRegistry& getInstance() {
+        static GLResourceRegistry instance;
+        return instance;
+    }
+
+    static const char* name(const EGLResource type);
+
+    // Stima per una texture 2D, la catena di mip completa aggiunge un terzo
+    static inline size_t textureBytes(const int width, const int height, const int components, const bool mipmapped = false) {
+        size_t bytes = static_cast<size_t>(width) * height * components;
+        return mipmapped ? bytes + bytes / 3 : bytes;
+    }
+
+    // Registrare due volte lo stesso oggetto non ha effetto
+    void track(const EGLResource type, const unsigned int id);
+
+    void untrack(const EGLResource type, const unsigned int id);
+
+    inline bool isTracked(const EGLResource type, const unsigned int id) const { return _objects.find(_key(type, id)) != _objects.end(); }
+
+    // Gli oggetti non registrati vengono ignorati
+    void setBytes(const EGLResource type, const unsigned int id, const size_t bytes);
+
+    void addBytes(const EGLResource type, const unsigned int id, const long long delta);
+
+    // Byte stimati di un oggetto, 0 se non e' registrato
+    size_t bytes(const EGLResource type, const unsigned int id) const;
+
+    inline const GLResourceStats& stats(const EGLResource type) const { return _stats[static_cast<int>(type)]; }
+
+    unsigned int liveObjects() const;
+
+    size_t totalBytes() const;
+
+    void report(std::ostream& out) const;
+};
+
+// Proprietario unico di un oggetto GL: lo cancella alla distruzione, si puo' solo spostare
+template <EGLResource Type>
+class GLHandle {
+private:
+    unsigned int _id = 0;
+
+    static unsigned int _generate();
+    static void _delete(const unsigned int id);
+
+public:
+    GLHandle() {}
+
+    // Prende in carico un oggetto creato altrove
+    explicit GLHandle(const unsigned int id) : _id(id) {
+        if (_id != 0)
+            GLResourceRegistry::getInstance().track(Type, _id);
+    }
+
+    GLHandle(GLHandle const&) = delete;
+    GLHandle& operator=(GLHandle const&) = delete;
+
+    GLHandle(GLHandle&& other) noexcept : _id(other._id) { other._id = 0; }
+
+    GLHandle& operator=(GLHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            _id = other._id;
+            other._id = 0;
+        }
+        return *this;
+    }
+
+    ~GLHandle() { reset(); }
+
+    static GLHandle create() { return GLHandle(_generate()); }
+
+    inline unsigned int id() const { return _id; }
+
+    inline explicit operator bool() const { return _id != 0; }
+
+    inline void setBytes(const size_t bytes) const { GLResourceRegistry::getInstance().setBytes(Type, _id, bytes); }
+
+    inline size_t bytes() const { return GLResourceRegistry::getInstance().bytes(Type, _id); }
+
+    void reset();
+
+    // Rinuncia alla proprieta' senza cancellare l'oggetto
+    unsigned int release();
+};
+
+using GLBuffer = GLHandle<EGLResource::buffer>;
+using GLVertexArray = GLHandle<EGLResource::vertexArray>;
+using GLTexture = GLHandle<EGLResource::texture>;
+using GLRenderbuffer = GLHandle<EGLResource::renderbuffer>;
+using GLFramebuffer = GLHandle<EGLResource::framebuffer>;
+using GLProgram = GLHandle<EGLResource::program>;
+
+// Insieme di oggetti GL posseduti da una renderable: le funzioni creano l'oggetto, ne mantengono la proprieta'
+// e restituiscono l'id da usare come prima
+class GLResources {
+private:
+    std::vector<GLBuffer> _buffers;
+    std::vector<GLVertexArray> _vertexArrays;
+    std::vector<GLTexture> _textures;
+    std::vector<GLRenderbuffer> _renderbuffers;
+    std::vector<GLFramebuffer> _framebuffers;
+
+public:
+    unsigned int buffer(const size_t bytes = 0);
+
+    unsigned int vertexArray();
+
+    unsigned int texture(const size_t bytes = 0);
+
+    unsigned int renderbuffer(const size_t bytes = 0);
+
+    unsigned int framebuffer();
+
+    // Byte stimati di tutti gli oggetti posseduti
+    size_t bytes() const;
+
+    void clear();
+};
+
+const char* GLResourceRegistry::name(const EGLResource type) {
+    switch (type) {
+    case EGLResource::buffer: return "buffer";
+    case EGLResource::vertexArray: return "vertex array";
+    case EGLResource::texture: return "texture";
+    case EGLResource::renderbuffer: return "renderbuffer";
+    case EGLResource::framebuffer: return "framebuffer";
+    case EGLResource::program: return "program";
+    }
+    return "unknown";
+}
+
+void GLResourceRegistry::track(const EGLResource type, const unsigned int id) {
+    if (!_objects.emplace(_key(type, id), 0).second)
+        return;
+
+    GLResourceStats& stats = _stats[static_cast<int>(type)];
+    stats.live++;
+    stats.created++;
+}
+
+void GLResourceRegistry::untrack(const EGLResource type, const unsigned int id) {
+    auto it = _objects.find(_key(type, id));
+    if (it == _objects.end())
+        return;
+
+    GLResourceStats& stats = _stats[static_cast<int>(type)];
+    stats.live--;
+    stats.deleted++;
+    stats.bytes -= it->second;
+    _objects.erase(it);
+}
+
+void GLResourceRegistry::setBytes(const EGLResource type, const unsigned int id, const size_t bytes) {
+    auto it = _objects.find(_key(type, id));
+    if (it == _objects.end())
+        return;
+
+    GLResourceStats& stats = _stats[static_cast<int>(type)];
+    stats.bytes = stats.bytes - it->second + bytes;
+    it->second = bytes;
+}
+
+void GLResourceRegistry::addBytes(const EGLResource type, const unsigned int id, const long long delta) {
+    auto it = _objects.find(_key(type, id));
+    if (it == _objects.end())
+        return;
+
+    setBytes(type, id, static_cast<size_t>(std::max(0LL, static_cast<long long>(it->second) + delta)));
+}
+
+size_t GLResourceRegistry::bytes(const EGLResource type, const unsigned int id) const {
+    auto it = _objects.find(_key(type, id));
+    return it == _objects.end() ? 0 : it->second;
+}
+
+unsigned int GLResourceRegistry::liveObjects() const {
+    unsigned int live = 0;
+    for (const auto& stats : _stats)
+        live += stats.live;
+    return live;
+}
+
+size_t GLResourceRegistry::totalBytes() const {
+    size_t bytes = 0;
+    for (const auto& stats : _stats)
+        bytes += stats.bytes;
+    return bytes;
+}
+
+void GLResourceRegistry::report(std::ostream& out) const {
+    out << "GL resources: " << liveObjects() << " live, " << std::fixed << std::setprecision(1) << totalBytes() / (1024.0 * 1024.0) << " MB" << std::endl;
+    for (int i = 0; i < GL_RESOURCE_TYPES; i++) {
+        const GLResourceStats& stats = _stats[i];
+        out << "  " << std::left << std::setw(14) << name(static_cast<EGLResource>(i)) << std::right
+            << std::setw(6) << stats.live << " live "
+            << std::setw(8) << std::setprecision(2) << stats.bytes / (1024.0 * 1024.0) << " MB "
+            << "(" << stats.created << " created, " << stats.deleted << " deleted)" << std::endl;
+    }
+}
+
+template <EGLResource Type>
+unsigned int GLHandle<Type>::_generate() {
+    unsigned int id = 0;
+    switch (Type) {
+    case EGLResource::buffer: glGenBuffers(1, &id); break;
+    case EGLResource::vertexArray: glGenVertexArrays(1, &id); break;
+    case EGLResource::texture: glGenTextures(1, &id); break;
+    case EGLResource::renderbuffer: glGenRenderbuffers(1, &id); break;
+    case EGLResource::framebuffer: glGenFramebuffers(1, &id); break;
+    case EGLResource::program: id = glCreateProgram(); break;
+    }
+    return id;
+}
+
+template <EGLResource Type>
+void GLHandle<Type>::_delete(const unsigned int id) {
+    switch (Type) {
+    case EGLResource::buffer: glDeleteBuffers(1, &id); break;
+    case EGLResource::vertexArray: glDeleteVertexArrays(1, &id); break;
+    case EGLResource::texture: glDeleteTextures(1, &id); break;
+    case EGLResource::renderbuffer: glDeleteRenderbuffers(1, &id); break;
+    case EGLResource::framebuffer: glDeleteFramebuffers(1, &id); break;
+    case EGLResource::program: glDeleteProgram(id); break;
+    }
+}
+
+template <EGLResource Type>
+void GLHandle<Type>::reset() {
+    if (_id == 0)
+        return;
+
+    _delete(_id);
+    GLResourceRegistry::getInstance().untrack(Type, _id);
+    _id = 0;
+}
+
+template <EGLResource Type>
+unsigned int GLHandle<Type>::release() {
+    unsigned int id = _id;
+    GLResourceRegistry::getInstance().untrack(Type, _id);
+    _id = 0;
+    return id;
+}
+
+unsigned int GLResources::buffer(const size_t bytes) {
+    _buffers.push_back(GLBuffer::create());
+    _buffers.back().setBytes(bytes);
+    return _buffers.back().id();
+}
+
+unsigned int GLResources::vertexArray() {
+    _vertexArrays.push_back(GLVertexArray::create());
+    return _vertexArrays.back().id();
+}
+
+unsigned int GLResources::texture(const size_t bytes) {
+    _textures.push_back(GLTexture::create());
+    _textures.back().setBytes(bytes);
+    return _textures.back().id();
+}
+
+unsigned int GLResources::renderbuffer(const size_t bytes) {
+    _renderbuffers.push_back(GLRenderbuffer::create());
+    _renderbuffers.back().setBytes(bytes);
+    return _renderbuffers.back().id();
+}
+
+unsigned int GLResources::framebuffer() {
+    _framebuffers.push_back(GLFramebuffer::create());
+    return _framebuffers.back().id();
+}
+
+size_t GLResources::bytes() const {
+    size_t bytes = 0;
+    for (const auto& buffer : _buffers)
+        bytes += buffer.bytes();
+    for (const auto& texture : _textures)
+        bytes += texture.bytes();
+    for (const auto& renderbuffer : _renderbuffers)
+        bytes += renderbuffer.bytes();
+    return bytes;
+}
+
+void GLResources::clear() {
+    // Prima i contenitori, poi gli oggetti a cui fanno riferimento
+    _framebuffers.clear();
+    _vertexArrays.clear();
+    _renderbuffers.clear();
+    _textures.clear();
+    _buffers.clear();
+}
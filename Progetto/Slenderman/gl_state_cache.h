@@ -0,0 +1,149 @@
+#pragma once
+
+#include <map>
+
+#include <glad/glad.h>
+
+const unsigned int GL_STATE_UNKNOWN = 0xFFFFFFFF;
+const unsigned int GL_STATE_MAX_TEXTURE_UNITS = 16;
+
+struct GLStateStats {
+    unsigned int issued = 0;
+    unsigned int elided = 0;
+};
+
+// Tiene traccia dello stato GL impostato dalla coda di rendering ed elimina le chiamate ridondanti.
+// Il codice che chiama GL direttamente (testo, immagini a schermo intero) rende lo stato sconosciuto:
+// per questo la coda invalida la cache all'inizio e alla fine di ogni flush
+class GLStateCache {
+private:
+    GLStateCache() { invalidate(); }
+
+    unsigned int _program;
+    unsigned int _VAO;
+    unsigned int _activeUnit;
+    unsigned int _textures[GL_STATE_MAX_TEXTURE_UNITS];
+    // I target 2D e 2D_ARRAY di un'unita' hanno binding separati
+    unsigned int _textureArrays[GL_STATE_MAX_TEXTURE_UNITS];
+    std::map<GLenum, bool> _capabilities;
+
+    GLStateStats _currentStats;
+    GLStateStats _lastFrameStats;
+
+    inline bool _track(const bool changed);
+
+public:
+    GLStateCache(GLStateCache const&) = delete;
+    void operator=(GLStateCache const&) = delete;
+
+    static GLStateCache& getInstance() {
+        static GLStateCache instance;
+        return instance;
+    }
+
+    void invalidate();
+
+    void useProgram(const unsigned int program);
+    void bindVertexArray(const unsigned int VAO);
+    void activeTexture(const unsigned int unit);
+    void bindTexture(const unsigned int unit, const unsigned int texture);
+    void bindTextureArray(const unsigned int unit, const unsigned int texture);
+    void enable(const GLenum capability);
+    void disable(const GLenum capability);
+
+    // Chiude le statistiche del frame corrente
+    void endFrame();
+
+    inline const GLStateStats& lastFrameStats() const { return _lastFrameStats; }
+};
+
+bool GLStateCache::_track(const bool changed) {
+    if (changed)
+        _currentStats.issued++;
+    else
+        _currentStats.elided++;
+    return changed;
+}
+
+void GLStateCache::invalidate() {
+    _program = GL_STATE_UNKNOWN;
+    _VAO = GL_STATE_UNKNOWN;
+    _activeUnit = GL_STATE_UNKNOWN;
+    for (unsigned int i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i++) {
+        _textures[i] = GL_STATE_UNKNOWN;
+        _textureArrays[i] = GL_STATE_UNKNOWN;
+    }
+    _capabilities.clear();
+}
+
+void GLStateCache::useProgram(const unsigned int program) {
+    if (_track(_program != program)) {
+        glUseProgram(program);
+        _program = program;
+    }
+}
+
+void GLStateCache::bindVertexArray(const unsigned int VAO) {
+    if (_track(_VAO != VAO)) {
+        glBindVertexArray(VAO);
+        _VAO = VAO;
+    }
+}
+
+void GLStateCache::activeTexture(const unsigned int unit) {
+    if (_track(_activeUnit != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        _activeUnit = unit;
+    }
+}
+
+void GLStateCache::bindTexture(const unsigned int unit, const unsigned int texture) {
+    if (unit >= GL_STATE_MAX_TEXTURE_UNITS) {
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        _currentStats.issued++;
+        return;
+    }
+
+    if (_track(_textures[unit] != texture)) {
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        _textures[unit] = texture;
+    }
+}
+
+void GLStateCache::bindTextureArray(const unsigned int unit, const unsigned int texture) {
+    if (unit >= GL_STATE_MAX_TEXTURE_UNITS) {
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        _currentStats.issued++;
+        return;
+    }
+
+    if (_track(_textureArrays[unit] != texture)) {
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        _textureArrays[unit] = texture;
+    }
+}
+
+void GLStateCache::enable(const GLenum capability) {
+    auto it = _capabilities.find(capability);
+    if (_track(it == _capabilities.end() || !it->second)) {
+        glEnable(capability);
+        _capabilities[capability] = true;
+    }
+}
+
+void GLStateCache::disable(const GLenum capability) {
+    auto it = _capabilities.find(capability);
+    if (_track(it == _capabilities.end() || it->second)) {
+        glDisable(capability);
+        _capabilities[capability] = false;
+    }
+}
+
+void GLStateCache::endFrame() {
+    _lastFrameStats = _currentStats;
+    _currentStats = GLStateStats();
+}
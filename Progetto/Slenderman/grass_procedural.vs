@@ -0,0 +1,72 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
+
+// indice (i, j) nella griglia della prima istanza del chunk
+uniform ivec2 chunkOrigin;
+uniform int vaoObjectSide;
+uniform int quadSide;
+uniform float offset;
+uniform int seed;
+uniform vec3 scale;
+
+const float PI = 3.14159265;
+
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// numero casuale in [0, 1) funzione solo di (seed, indice dell'istanza, stream)
+float random(uint index, uint stream)
+{
+    return float(hash(hash(uint(seed) ^ hash(index)) + stream) >> 8) / 16777216.0;
+}
+
+void main()
+{
+    int i = chunkOrigin.x + gl_InstanceID / vaoObjectSide;
+    int j = chunkOrigin.y + gl_InstanceID % vaoObjectSide;
+    uint index = uint(i * quadSide + j);
+
+    // 1. Traslazione in base all'indice della griglia con offset casuale
+    float rx = random(index, 0u) * offset / 2.0;
+    float rz = random(index, 1u) * offset / 2.0;
+    vec3 translation = vec3((i - quadSide / 2) * offset + rx, -4.0, (j - quadSide / 2) * offset + rz);
+
+    // 2. Scala e 3. rotazione casuale attorno all'asse y
+    float yaw = random(index, 2u) * 2.0 * PI;
+    float c = cos(yaw);
+    float s = sin(yaw);
+    mat4 model = mat4(
+        scale.x * c, 0.0, scale.z * -s, 0.0,
+        0.0, scale.y, 0.0, 0.0,
+        scale.x * s, 0.0, scale.z * c, 0.0,
+        translation, 1.0
+    );
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    // Matrice delle normali analitica: S^-1 * R_y
+    Normal = vec3(c * aNormal.x + s * aNormal.z, aNormal.y, -s * aNormal.x + c * aNormal.z) / scale;
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+out float Depth;
+
+uniform sampler2D depthTexture;
+// porzione della depth usata dalla scena (risoluzione dinamica) e dimensione della destinazione
+uniform ivec2 sourceSize;
+uniform ivec2 targetSize;
+
+// Ogni texel della destinazione tiene la profondita' massima dei texel che copre:
+// un oggetto piu' lontano di questo valore e' nascosto in tutta l'area
+void main()
+{
+    ivec2 target = ivec2(gl_FragCoord.xy);
+    ivec2 start = target * sourceSize / targetSize;
+    ivec2 end = max((target + 1) * sourceSize / targetSize, start + 1);
+
+    float depth = 0.0;
+    for (int y = start.y; y < end.y; y++)
+        for (int x = start.x; x < end.x; x++)
+            depth = max(depth, texelFetch(depthTexture, ivec2(x, y), 0).r);
+    Depth = depth;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D atlas;
+uniform float alphaValue;
+uniform float brightness;
+
+void main()
+{
+    vec4 textColor = texture(atlas, TexCoords);
+    if(textColor.a < alphaValue)
+        discard;
+
+    FragColor = vec4(textColor.rgb * brightness, 1.0);
+}
@@ -0,0 +1,39 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+layout (location = 1) in vec4 aInstancePositionYaw;
+
+out vec2 TexCoords;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
+uniform vec2 billboardSize;
+uniform float billboardBottom;
+uniform int numAngles;
+
+const float PI = 3.14159265;
+
+void main()
+{
+    vec3 center = aInstancePositionYaw.xyz;
+    vec3 toCamera = cameraPosition.xyz - center;
+    toCamera.y = 0.0;
+    toCamera = length(toCamera) > 0.0001 ? normalize(toCamera) : vec3(0.0, 0.0, 1.0);
+
+    // il billboard ruota solo attorno all'asse y
+    vec3 right = vec3(toCamera.z, 0.0, -toCamera.x);
+    vec3 worldPos = center + right * (aCorner.x * billboardSize.x);
+    worldPos.y += billboardBottom + aCorner.y * billboardSize.y;
+
+    // sceglie il frame dell'atlas in base all'angolo di vista nello spazio del modello
+    float modelAngle = atan(toCamera.x, toCamera.z) - aInstancePositionYaw.w;
+    float frame = mod(floor(modelAngle / (2.0 * PI / numAngles) + 0.5), float(numAngles));
+
+    TexCoords = vec2((frame + aCorner.x + 0.5) / numAngles, aCorner.y);
+    gl_Position = viewProjection * vec4(worldPos, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform sampler2D texture_diffuse1;
+uniform vec3 lightDir;
+uniform float alphaValue;
+
+void main()
+{
+    vec4 textColor = texture(texture_diffuse1, TexCoords);
+    if(textColor.a < alphaValue)
+        discard;
+
+    float diff = 0.4 + 0.6 * max(dot(normalize(Normal), normalize(lightDir)), 0.0);
+    FragColor = vec4(textColor.rgb * diff, 1.0);
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cmath>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "constants.h"
+#include "dynamic_map_renderable.h"
+#include "light_utils.h"
+#include "occlusion_culler.h"
+#include "render_queue.h"
+#include "renderable.h"
+#include "shader_cache.h"
+#include "streaming_buffer.h"
+
+class TreeImpostorRenderable : public VAORenderable {
+private:
+    Shader* _bakeShader;
+
+    // Offset delle istanze visibili del frame nel buffer di streaming
+    size_t _instanceOffset = 0;
+    unsigned int _atlasFramebuffer;
+    unsigned int _atlasDepthBuffer;
+
+    // { vaoIndex - istanze (posizione, yaw) del chunk }
+    std::vector<std::vector<glm::vec4>> _chunkInstances;
+    std::vector<glm::vec4> _visibleInstances;
+    std::unordered_set<int> _hiddenChunks;
+
+    glm::vec2 _billboardSize;
+    float _billboardBottom;
+
+    void _bakeAtlas(const Model& model, const float radius, const float minY, const float maxY);
+    void _initBillboardVAO();
+
+public:
+    TreeImpostorRenderable(const InstancedModelRenderable& forest);
+
+    ~TreeImpostorRenderable() {
+        _chunkInstances.clear();
+        _chunkInstances.shrink_to_fit();
+        _visibleInstances.clear();
+        _visibleInstances.shrink_to_fit();
+    }
+
+    // Chunk da non disegnare nella partita corrente (quelli dei POI)
+    inline void setHiddenChunks(const std::unordered_set<int>& hiddenChunks) { _hiddenChunks = hiddenChunks; }
+
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
+
+    virtual MemoryUsage memoryUsage() const override;
+};
+
+TreeImpostorRenderable::TreeImpostorRenderable(const InstancedModelRenderable& forest) {
+    _shader = ShaderCache::getInstance().findShader(EShader::impostor);
+    _bakeShader = ShaderCache::getInstance().findShader(EShader::impostorBake);
+
+    const Model& model = *forest.model();
+
+    // Bounding del modello attorno all'asse di rotazione (x = 0, z = 0)
+    float radius = 0.0f;
+    float minY = FLT_MAX;
+    float maxY = -FLT_MAX;
+    for (const auto& mesh : model.meshes) {
+        for (const auto& vertex : mesh.vertices) {
+            radius = std::max(radius, glm::length(glm::vec2(vertex.Position.x, vertex.Position.z)));
+            minY = std::min(minY, vertex.Position.y);
+            maxY = std::max(maxY, vertex.Position.y);
+        }
+    }
+
+    // Gli alberi hanno scala uniforme, la si ricava dalla prima istanza
+    float scale = forest.instances().empty() ? 1.0f : forest.instances()[0].getScale();
+    _billboardSize = glm::vec2(2.0f * radius * scale, (maxY - minY) * scale);
+    _billboardBottom = minY * scale;
+
+    int numVAOForSide = TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE;
+    _chunkInstances.resize(numVAOForSide * numVAOForSide);
+
+    for (const auto& instance : forest.instances()) {
+        glm::vec3 position = instance.position;
+        float yaw = instance.getYaw();
+
+        // Gli alberi non hanno offset casuale, l'indice della griglia si ricava dalla traslazione
+        int i = static_cast<int>(round(position.x / TREE_OFFSET)) + TREE_QUAD_SIDE / 2;
+        int j = static_cast<int>(round(position.z / TREE_OFFSET)) + TREE_QUAD_SIDE / 2;
+        int vaoIndex = ((i / VAO_OBJECTS_SIDE_TREE) * numVAOForSide) + (j / VAO_OBJECTS_SIDE_TREE);
+
+        _chunkInstances[vaoIndex].push_back(glm::vec4(position, yaw));
+    }
+
+    _bakeAtlas(model, radius, minY, maxY);
+    _initBillboardVAO();
+}
+
+MemoryUsage TreeImpostorRenderable::memoryUsage() const {
+    MemoryUsage usage = VAORenderable::memoryUsage();
+    usage.cpuBytes += vectorBytes(_chunkInstances) + vectorBytes(_visibleInstances);
+    for (const auto& chunk : _chunkInstances)
+        usage.cpuBytes += vectorBytes(chunk);
+    return usage;
+}
+
+void TreeImpostorRenderable::_bakeAtlas(const Model& model, const float radius, const float minY, const float maxY) {
+    const int atlasWidth = IMPOSTOR_FRAME_SIZE * IMPOSTOR_ANGLES;
+    const int atlasHeight = IMPOSTOR_FRAME_SIZE;
+
+    _atlasFramebuffer = _glResources.framebuffer();
+    glBindFramebuffer(GL_FRAMEBUFFER, _atlasFramebuffer);
+
+    _texture = _glResources.texture(GLResourceRegistry::textureBytes(atlasWidth, atlasHeight, 4, true));
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _texture, 0);
+
+    _atlasDepthBuffer = _glResources.renderbuffer(GLResourceRegistry::textureBytes(atlasWidth, atlasHeight, 4));
+    glBindRenderbuffer(GL_RENDERBUFFER, _atlasDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, atlasWidth, atlasHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _atlasDepthBuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        cout << "ERROR::FRAMEBUFFER:: Impostor atlas framebuffer is not complete!" << endl;
+
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    float centerY = (minY + maxY) / 2.0f;
+    float halfHeight = (maxY - minY) / 2.0f;
+    glm::mat4 projection = glm::ortho(-radius, radius, -halfHeight, halfHeight, 0.0f, 4.0f * radius);
+
+    _bakeShader->use();
+    _bakeShader->setMat4("projection", projection);
+    _bakeShader->setVec3("lightDir", glm::vec3(0.3f, 1.0f, 0.5f));
+    _bakeShader->setFloat("alphaValue", 0.4f);
+
+    for (int k = 0; k < IMPOSTOR_ANGLES; k++) {
+        float angle = k * 2.0f * M_PI / IMPOSTOR_ANGLES;
+        glm::vec3 eye = glm::vec3(sin(angle) * 2.0f * radius, centerY, cos(angle) * 2.0f * radius);
+        _bakeShader->setMat4("view", glm::lookAt(eye, glm::vec3(0.0f, centerY, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        glViewport(k * IMPOSTOR_FRAME_SIZE, 0, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+        for (const auto& mesh : model.meshes) {
+            for (unsigned int j = 0; j < mesh.textures.size(); j++) {
+                TextureStreamer::getInstance().makeResident(mesh.textures[j].id);
+                glActiveTexture(GL_TEXTURE0 + j);
+                glBindTexture(GL_TEXTURE_2D, mesh.textures[j].id);
+            }
+            glBindVertexArray(mesh.VAO);
+            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        }
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindTexture(GL_TEXTURE_2D, _texture);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+}
+
+void TreeImpostorRenderable::_initBillboardVAO() {
+    float corners[] = {
+        -0.5f, 0.0f,
+         0.5f, 0.0f,
+         0.5f, 1.0f,
+
+        -0.5f, 0.0f,
+         0.5f, 1.0f,
+        -0.5f, 1.0f
+    };
+
+    _VAO = _glResources.vertexArray();
+    unsigned int VBO = _glResources.buffer(sizeof(corners));
+    glBindVertexArray(_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    // Le istanze visibili cambiano a ogni frame: l'attributo punta al buffer di streaming, l'offset si aggiorna in draw
+    glBindBuffer(GL_ARRAY_BUFFER, StreamingBuffer::getInstance().buffer());
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+    glVertexAttribDivisor(1, 1);
+
+    glBindVertexArray(0);
+}
+
+void TreeImpostorRenderable::submit(RenderQueue& queue, const Camera& camera) {
+    float chunkRadius = VAO_OBJECTS_SIDE_TREE * TREE_OFFSET;
+    glm::vec2 cameraPosition = glm::vec2(camera.Position.x, camera.Position.z);
+    glm::vec2 cameraFront = glm::vec2(camera.Front.x, camera.Front.z);
+
+    _visibleInstances.clear();
+    for (size_t k = 0; k < _chunkInstances.size(); k++) {
+        if (_chunkInstances[k].empty() || _hiddenChunks.find(static_cast<int>(k)) != _hiddenChunks.end())
+            continue;
+        if (DynamicMapRenderable::isChunkNear(k, camera, IMPOSTOR_DISTANCE, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE))
+            continue;
+        // Oltre il piano lontano il chunk verrebbe comunque tagliato
+        if (!DynamicMapRenderable::isChunkNear(k, camera, FAR_CLIPPING_PLANE + chunkRadius, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE))
+            continue;
+
+        // Scarta i chunk completamente alle spalle della camera
+        glm::vec2 center = DynamicMapRenderable::chunkCenter(k, TREE_OFFSET, TREE_QUAD_SIDE, VAO_OBJECTS_SIDE_TREE);
+        if (glm::dot(center - cameraPosition, cameraFront) < -chunkRadius)
+            continue;
+
+        if (USE_OCCLUSION_CULLING) {
+            // I billboard ruotano verso la camera: mezza larghezza in ogni direzione attorno alle istanze
+            float halfSide = VAO_OBJECTS_SIDE_TREE * TREE_OFFSET / 2 + _billboardSize.x / 2;
+            float y = _chunkInstances[k][0].y + _billboardBottom;
+            CullBounds bounds;
+            bounds.min = glm::vec3(center.x - halfSide, y, center.y - halfSide);
+            bounds.max = glm::vec3(center.x + halfSide, y + _billboardSize.y, center.y + halfSide);
+            if (!OcclusionCuller::getInstance().isVisible(bounds, EOcclusionGroup::chunk))
+                continue;
+        }
+
+        _visibleInstances.insert(_visibleInstances.end(), _chunkInstances[k].begin(), _chunkInstances[k].end());
+    }
+
+    if (_visibleInstances.empty())
+        return;
+
+    _instanceOffset = StreamingBuffer::getInstance().upload(&_visibleInstances[0], _visibleInstances.size() * sizeof(glm::vec4), sizeof(glm::vec4));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.texture = _texture;
+    packet.VAO = _VAO;
+    queue.submit(packet);
+}
+
+void TreeImpostorRenderable::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    _shader->setVec2("billboardSize", _billboardSize);
+    _shader->setFloat("billboardBottom", _billboardBottom);
+    _shader->setInt("numAngles", IMPOSTOR_ANGLES);
+    _shader->setFloat("alphaValue", 0.4f);
+    _shader->setFloat("brightness", IMPOSTOR_BRIGHTNESS);
+
+    // Il VAO e' gia' legato dalla coda, gli attributi per istanza non hanno un primo elemento nel draw
+    glBindBuffer(GL_ARRAY_BUFFER, StreamingBuffer::getInstance().buffer());
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)_instanceOffset);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, _visibleInstances.size());
+}
@@ -4,6 +4,8 @@
 
 #include "constants.h"
 #include "camera.h"
+#include "frame_clock.h"
+#include "input_recorder.h"
 
 static float _lastX = 0;
 static float _lastY = 0;
@@ -12,6 +14,9 @@ static bool _mouseMoved = false;
 static GLFWwindow* _window = nullptr;
 static Camera* _camera = nullptr;
 
+// Input del frame corrente in registrazione e riproduzione
+static InputFrame _inputFrame;
+
 class InputManager {
 private:
     static void processMouse(GLFWwindow* window, double xPos, double yPos);
@@ -19,6 +24,10 @@ private:
 public:
     static void init(GLFWwindow* window, Camera* camera);
 
+    // Da chiamare dopo glfwPollEvents e FrameClock::tick. In registrazione salva l'input del frame,
+    // in riproduzione sostituisce input e delta con quelli registrati. False quando la riproduzione e' finita
+    static bool beginFrame(FrameClock& clock);
+
     inline static void bindCamera(Camera* camera);
     
     inline static bool isKeyPressed(int key);
@@ -34,7 +43,31 @@ void InputManager::init(GLFWwindow* window, Camera* camera) {
     _window = window;
     _camera = camera;
 
-    glfwSetCursorPosCallback(window, InputManager::processMouse);
+    // In registrazione e riproduzione il cursore viene applicato una volta per frame da beginFrame
+    if (!InputRecorder::getInstance().isActive())
+        glfwSetCursorPosCallback(window, InputManager::processMouse);
+}
+
+bool InputManager::beginFrame(FrameClock& clock) {
+    InputRecorder& recorder = InputRecorder::getInstance();
+    if (recorder.mode() == EInputMode::live)
+        return true;
+
+    if (recorder.mode() == EInputMode::record) {
+        _inputFrame = InputFrame::sample(_window, clock.deltaTime);
+        recorder.write(_inputFrame);
+    }
+    else if (recorder.read(_inputFrame)) {
+        clock.replay(_inputFrame.deltaTime);
+    }
+    else {
+        // Fine della riproduzione: nessun tasto premuto, il cursore resta fermo
+        _inputFrame.buttons = 0;
+        return false;
+    }
+
+    processMouse(_window, _inputFrame.cursorX, _inputFrame.cursorY);
+    return true;
 }
 
 inline void InputManager::bindCamera(Camera* camera) {
@@ -59,9 +92,13 @@ void InputManager::processMouse(GLFWwindow* window, double xPos, double yPos) {
 }
 
 bool InputManager::isKeyPressed(int key) {
+    if (InputRecorder::getInstance().isActive())
+        return _inputFrame.isKeyPressed(key);
     return glfwGetKey(_window, key) == GLFW_PRESS;
 }
 
 bool InputManager::isLeftMouseButtonPressed() {
+    if (InputRecorder::getInstance().isActive())
+        return _inputFrame.isLeftMouseButtonPressed();
     return glfwGetMouseButton(_window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
 }
\ No newline at end of file
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <GLFW/glfw3.h>
+
+// Tasti salvati nella registrazione, un bit ciascuno. Il bit successivo all'ultimo tasto e' il tasto sinistro del mouse
+const int RECORDED_KEYS[] = {
+    GLFW_KEY_W,
+    GLFW_KEY_S,
+    GLFW_KEY_A,
+    GLFW_KEY_D,
+    GLFW_KEY_LEFT_SHIFT,
+    GLFW_KEY_F,
+    GLFW_KEY_ESCAPE,
+    GLFW_KEY_M,
+    GLFW_KEY_SPACE,
+    GLFW_KEY_Q,
+    GLFW_KEY_ENTER
+};
+const int NUM_RECORDED_KEYS = sizeof(RECORDED_KEYS) / sizeof(RECORDED_KEYS[0]);
+const uint16_t RECORDED_LEFT_MOUSE_BIT = 1 << NUM_RECORDED_KEYS;
+
+const uint32_t INPUT_RECORDING_MAGIC = 0x52494C53;    // "SLIR"
+const uint32_t INPUT_RECORDING_VERSION = 1;
+
+enum class EInputMode {
+    live,
+    record,
+    replay
+};
+
+// Input di un frame: delta del FrameClock, tasti premuti e posizione del cursore.
+// Su file sono 14 byte senza padding, circa 50 KB al minuto a 60 fps
+struct InputFrame {
+    float deltaTime = 0.0f;
+    uint16_t buttons = 0;
+    float cursorX = 0.0f;
+    float cursorY = 0.0f;
+
+    static InputFrame sample(GLFWwindow* window, const float deltaTime);
+
+    bool isKeyPressed(const int key) const;
+
+    inline bool isLeftMouseButtonPressed() const { return (buttons & RECORDED_LEFT_MOUSE_BIT) != 0; }
+};
+
+// Registrazione e riproduzione dell'input per frame. Il file contiene un'intestazione con il seed della sessione,
+// da cui MapInitializer ricava i seed delle partite, seguita da un InputFrame per ogni frame.
+// Con lo stesso file la riproduzione ripete mappa, percorso e inquadrature della sessione registrata
+class InputRecorder {
+private:
+    InputRecorder() {}
+
+    EInputMode _mode = EInputMode::live;
+    std::string _path;
+    std::ofstream _output;
+    std::ifstream _input;
+    uint32_t _seed = 0;
+    unsigned long long _frames = 0;
+    bool _finished = false;
+
+public:
+    InputRecorder(InputRecorder const&) = delete;
+    void operator=(InputRecorder const&) = delete;
+
+    static InputRecorder& getInstance() {
+        static InputRecorder instance;
+        return instance;
+    }
+
+    bool startRecording(const std::string& path);
+
+    bool startReplay(const std::string& path);
+
+    inline EInputMode mode() const { return _mode; }
+
+    // Registrazione o riproduzione in corso: la partita deve dipendere solo dai frame del file
+    inline bool isActive() const { return _mode != EInputMode::live; }
+
+    inline uint32_t seed() const { return _seed; }
+
+    inline unsigned long long frames() const { return _frames; }
+
+    // Riproduzione arrivata alla fine del file
+    inline bool isFinished() const { return _finished; }
+
+    void write(const InputFrame& frame);
+
+    // Legge il frame successivo, false a fine file
+    bool read(InputFrame& frame);
+
+    void stop();
+};
+
+InputFrame InputFrame::sample(GLFWwindow* window, const float deltaTime) {
+    InputFrame frame;
+    frame.deltaTime = deltaTime;
+    for (int i = 0; i < NUM_RECORDED_KEYS; i++)
+        if (glfwGetKey(window, RECORDED_KEYS[i]) == GLFW_PRESS)
+            frame.buttons |= 1 << i;
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+        frame.buttons |= RECORDED_LEFT_MOUSE_BIT;
+
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    frame.cursorX = static_cast<float>(x);
+    frame.cursorY = static_cast<float>(y);
+    return frame;
+}
+
+bool InputFrame::isKeyPressed(const int key) const {
+    for (int i = 0; i < NUM_RECORDED_KEYS; i++)
+        if (RECORDED_KEYS[i] == key)
+            return (buttons & (1 << i)) != 0;
+    return false;
+}
+
+bool InputRecorder::startRecording(const std::string& path) {
+    if (isActive())
+        return false;
+
+    _output.open(path, std::ios::binary | std::ios::trunc);
+    if (!_output) {
+        std::cout << "ERROR::INPUT:: Cannot create recording " << path << std::endl;
+        return false;
+    }
+
+    _seed = static_cast<uint32_t>(time(NULL));
+    _output.write(reinterpret_cast<const char*>(&INPUT_RECORDING_MAGIC), sizeof(uint32_t));
+    _output.write(reinterpret_cast<const char*>(&INPUT_RECORDING_VERSION), sizeof(uint32_t));
+    _output.write(reinterpret_cast<const char*>(&_seed), sizeof(uint32_t));
+
+    _mode = EInputMode::record;
+    _path = path;
+    return true;
+}
+
+bool InputRecorder::startReplay(const std::string& path) {
+    if (isActive())
+        return false;
+
+    _input.open(path, std::ios::binary);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    _input.read(reinterpret_cast<char*>(&magic), sizeof(uint32_t));
+    _input.read(reinterpret_cast<char*>(&version), sizeof(uint32_t));
+    _input.read(reinterpret_cast<char*>(&_seed), sizeof(uint32_t));
+    if (!_input || magic != INPUT_RECORDING_MAGIC || version != INPUT_RECORDING_VERSION) {
+        std::cout << "ERROR::INPUT:: " << path << " is not a valid input recording" << std::endl;
+        _input.close();
+        return false;
+    }
+
+    _mode = EInputMode::replay;
+    _path = path;
+    return true;
+}
+
+void InputRecorder::write(const InputFrame& frame) {
+    if (_mode != EInputMode::record)
+        return;
+
+    _output.write(reinterpret_cast<const char*>(&frame.deltaTime), sizeof(frame.deltaTime));
+    _output.write(reinterpret_cast<const char*>(&frame.buttons), sizeof(frame.buttons));
+    _output.write(reinterpret_cast<const char*>(&frame.cursorX), sizeof(frame.cursorX));
+    _output.write(reinterpret_cast<const char*>(&frame.cursorY), sizeof(frame.cursorY));
+    _frames++;
+}
+
+bool InputRecorder::read(InputFrame& frame) {
+    if (_mode != EInputMode::replay || _finished)
+        return false;
+
+    InputFrame next;
+    _input.read(reinterpret_cast<char*>(&next.deltaTime), sizeof(next.deltaTime));
+    _input.read(reinterpret_cast<char*>(&next.buttons), sizeof(next.buttons));
+    _input.read(reinterpret_cast<char*>(&next.cursorX), sizeof(next.cursorX));
+    _input.read(reinterpret_cast<char*>(&next.cursorY), sizeof(next.cursorY));
+    if (!_input) {
+        _finished = true;
+        return false;
+    }
+
+    frame = next;
+    _frames++;
+    return true;
+}
+
+void InputRecorder::stop() {
+    if (_mode == EInputMode::record) {
+        _output.close();
+        std::cout << "Recorded " << _frames << " frames to " << _path << std::endl;
+    }
+    if (_mode == EInputMode::replay)
+        _input.close();
+
+    _mode = EInputMode::live;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+// Record di un'istanza: alberi, erba e recinzione usano solo traslazione, scala e rotazione attorno a Y,
+// quindi bastano 16 byte al posto di una glm::mat4 (64 byte)
+struct InstanceData {
+    glm::vec3 position;
+    uint16_t yaw;   // half float, radianti in [0, 2pi)
+    uint16_t scale; // half float
+
+    static InstanceData make(const glm::vec3& position, const float yaw, const float scale);
+
+    inline float getYaw() const { return glm::unpackHalf1x16(yaw); }
+
+    inline float getScale() const { return glm::unpackHalf1x16(scale); }
+
+    // scaleAxes permette una scala non uniforme condivisa da tutte le istanze (es. l'erba)
+    glm::mat4 toMatrix(const glm::vec3& scaleAxes = glm::vec3(1.0f)) const;
+
+    // Attributi per istanza del VAO attualmente bindato: location 3 posizione, location 4 (yaw, scala)
+    static void setupAttributes();
+};
+
+static_assert(sizeof(InstanceData) == 16, "InstanceData deve occupare 16 byte");
+
+InstanceData InstanceData::make(const glm::vec3& position, const float yaw, const float scale) {
+    // L'angolo viene ricondotto in [0, 2pi) per non perdere precisione nella conversione a half float
+    float twoPi = 2.0f * glm::pi<float>();
+    float normalizedYaw = fmod(yaw, twoPi);
+    if (normalizedYaw < 0.0f)
+        normalizedYaw += twoPi;
+
+    InstanceData instance;
+    instance.position = position;
+    instance.yaw = glm::packHalf1x16(normalizedYaw);
+    instance.scale = glm::packHalf1x16(scale);
+    return instance;
+}
+
+glm::mat4 InstanceData::toMatrix(const glm::vec3& scaleAxes) const {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    transform = glm::scale(transform, getScale() * scaleAxes);
+    return glm::rotate(transform, getYaw(), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void InstanceData::setupAttributes() {
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)0);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(sizeof(glm::vec3)));
+
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+}
@@ -14,8 +14,13 @@ public:
     
     void initLightShader(Shader* shader, const Camera& camera) const;
 
+    // Come initLightShader, ma con il programma dello shader gia' in uso
+    void uploadLights(Shader* shader, const Camera& camera) const;
+
     inline void flipLightOn();
 
+    inline void setLightOn(const bool on) { lightOn = on; }
+
 private:
     std::vector<glm::vec3> lightTranslationVec;
     bool lightOn = true;
@@ -38,6 +43,10 @@ inline void LightUtils::flipLightOn() {
 
 void LightUtils::initLightShader(Shader* shader, const Camera& camera) const {
     shader->use();
+    uploadLights(shader, camera);
+}
+
+void LightUtils::uploadLights(Shader* shader, const Camera& camera) const {
     initSpotLight(shader, camera);
     for (int i = 0; i < lightTranslationVec.size(); i++) {
         initPointLightForPoi(shader, lightTranslationVec[i], i);
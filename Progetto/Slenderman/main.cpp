@@ -1,10 +1,22 @@
+#include <cstring>
+
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "game.h"
 #include "glfw_utils.h"
+#include "input_recorder.h"
+
+// Slenderman.exe --record sessione.input    registra l'input della sessione
+// Slenderman.exe --replay sessione.input    riproduce la sessione e stampa i tempi dei frame alla fine
+int main(int argc, char** argv) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0)
+            InputRecorder::getInstance().startRecording(argv[++i]);
+        else if (strcmp(argv[i], "--replay") == 0)
+            InputRecorder::getInstance().startReplay(argv[++i]);
+    }
 
-int main() {
     GLFWwindow* window = initGlfw();
     if (window == nullptr)
         return -1;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <time.h>
 #include <stdexcept>
@@ -9,11 +10,15 @@
 
 #include "collision_solver.h"
 #include "constants.h"
+#include "input_recorder.h"
 #include "model_cache.h"
+#include "map_random.h"
 #include "page.h"
 #include "renderable.h"
 #include "renderable_poi.h"
+#include "spawn_point_grid.h"
 #include "street_light.h"
+#include "thread_pool.h"
 
 class MapInitializer {
 private:
@@ -22,11 +27,14 @@ private:
     static glm::mat4 _computePOITransformForModel(EModel model, const glm::vec3& poiTranslation);
 
 public:
-    static std::map<int, glm::vec3> initPOI();
+    // MAP_SEED se impostato, altrimenti un seed diverso a ogni partita
+    static uint32_t mapSeed();
 
-    static std::vector<glm::vec3> initSlenderSpawnPoints(std::map<int, glm::vec3> poiInfo);
+    static std::map<int, glm::vec3> initPOI(const uint32_t mapSeed);
 
-    static void addPOIRenderablesAndStreetLights(const std::map<int, glm::vec3>& poiInfo, std::vector<Page*>& pages, vector<Renderable*>& renderables, CollisionSolver& collisionSolver);
+    static SpawnPointGrid initSlenderSpawnPoints(const std::map<int, glm::vec3>& poiInfo);
+
+    static void addPOIRenderablesAndStreetLights(const uint32_t mapSeed, const std::map<int, glm::vec3>& poiInfo, std::vector<Page*>& pages, vector<Renderable*>& renderables, CollisionSolver& collisionSolver);
 };
 
 bool MapInitializer::_isGoodPOI(const int k, const std::map<int, glm::vec3>& poi, const int kMax, const int numVAOForSide) {
@@ -56,18 +64,32 @@ bool MapInitializer::_isGoodPOI(const int k, const std::map<int, glm::vec3>& poi
     return true;
 }
 
-std::map<int, glm::vec3> MapInitializer::initPOI() {
+uint32_t MapInitializer::mapSeed() {
+    if (MAP_SEED != 0)
+        return MAP_SEED;
+
+    // Il contatore distingue due partite iniziate nello stesso secondo. Registrando o riproducendo l'input
+    // si parte dal seed della registrazione, cosi' ogni partita ritrova la sua mappa
+    static uint32_t runs = 0;
+    InputRecorder& recorder = InputRecorder::getInstance();
+    uint32_t base = recorder.isActive() ? recorder.seed() : static_cast<uint32_t>(time(NULL));
+    return MapRandom::hash(base ^ MapRandom::hash(++runs));
+}
+
+std::map<int, glm::vec3> MapInitializer::initPOI(const uint32_t mapSeed) {
     std::map<int, glm::vec3> poiMap;
 
-    srand(time(NULL));
+    uint32_t seed = MapRandom::seedFor(mapSeed, EMapStream::poi);
+    // I tentativi scartati consumano comunque un indice, la sequenza dipende solo dal seed
+    uint32_t attempt = 0;
 
     int numVAOForSide = TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE;
     int kMax = (numVAOForSide * numVAOForSide) - 1;
 
     for (int i = 0; i < NUMBER_POINTS_OF_INTEREST; i++) {
-        int k = static_cast <float> (rand()) / static_cast <float> (RAND_MAX) * kMax;
+        int k = MapRandom::random(seed, attempt++) * kMax;
         while (!_isGoodPOI(k, poiMap, kMax, numVAOForSide)) {
-            k = static_cast <float> (rand()) / static_cast <float> (RAND_MAX) * kMax;
+            k = MapRandom::random(seed, attempt++) * kMax;
         }
 
         int x_index = k / numVAOForSide;
@@ -83,15 +105,17 @@ std::map<int, glm::vec3> MapInitializer::initPOI() {
     return poiMap;
 }
 
-std::vector<glm::vec3> MapInitializer::initSlenderSpawnPoints(std::map<int, glm::vec3> poiInfo) {
-    std::vector<glm::vec3> slendermanSpawnPoints;
+SpawnPointGrid MapInitializer::initSlenderSpawnPoints(const std::map<int, glm::vec3>& poiInfo) {
+    // Una riga della griglia per task, le righe vengono poi concatenate nell'ordine originale
+    std::vector<std::vector<glm::vec3>> rows(TREE_QUAD_SIDE);
     int numVaoForSide = TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE;
-    for (int i = 0; i < TREE_QUAD_SIDE; i++) {
+
+    ThreadPool::getInstance().parallelFor(TREE_QUAD_SIDE, [&](int i) {
         for (int j = 0; j < TREE_QUAD_SIDE; j++) {
 
             unsigned int vao_i = floor(i / VAO_OBJECTS_SIDE_TREE);
             unsigned int vao_j = floor(j / VAO_OBJECTS_SIDE_TREE);
-            unsigned int vao_index = (vao_i * (TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE)) + vao_j;
+            int vao_index = static_cast<int>((vao_i * (TREE_QUAD_SIDE / VAO_OBJECTS_SIDE_TREE)) + vao_j);
 
             // Esclude i POI
             if (poiInfo.find(vao_index) != poiInfo.end()) {
@@ -100,7 +124,7 @@ std::vector<glm::vec3> MapInitializer::initSlenderSpawnPoints(std::map<int, glm:
 
             // Esclude i 4 lati esterni
             int kMax = numVaoForSide * numVaoForSide - 1;
-            if (vao_index < numVaoForSide || vao_index >(kMax - numVaoForSide)) {
+            if (vao_index < numVaoForSide || vao_index > (kMax - numVaoForSide)) {
                 continue;
             }
             if (vao_index % numVaoForSide == 0 || (vao_index + 1) % numVaoForSide == 0) {
@@ -111,10 +135,14 @@ std::vector<glm::vec3> MapInitializer::initSlenderSpawnPoints(std::map<int, glm:
             float y_slender = -0.8f;
             float z_slender = (j - TREE_QUAD_SIDE / 2) * TREE_OFFSET + SLENDERMAN_OUT_OF_TREE_OFFSET;
 
-            slendermanSpawnPoints.push_back(glm::vec3(x_slender, y_slender, z_slender));
+            rows[i].push_back(glm::vec3(x_slender, y_slender, z_slender));
         }
-    }
-    return slendermanSpawnPoints;
+    });
+
+    std::vector<glm::vec3> slendermanSpawnPoints;
+    for (const auto& row : rows)
+        slendermanSpawnPoints.insert(slendermanSpawnPoints.end(), row.begin(), row.end());
+    return SpawnPointGrid(slendermanSpawnPoints);
 }
 
 glm::mat4 MapInitializer::_computePOITransformForModel(EModel model, const glm::vec3& poiTranslation) {
@@ -178,12 +206,15 @@ glm::mat4 MapInitializer::_computePOITransformForModel(EModel model, const glm::
     return transform;
 }
 
-void MapInitializer::addPOIRenderablesAndStreetLights(const std::map<int, glm::vec3>& poiInfo, std::vector<Page*>& pages, vector<Renderable*>& renderables, CollisionSolver& collisionSolver) {   
+void MapInitializer::addPOIRenderablesAndStreetLights(const uint32_t mapSeed, const std::map<int, glm::vec3>& poiInfo, std::vector<Page*>& pages, vector<Renderable*>& renderables, CollisionSolver& collisionSolver) {   
+    uint32_t seed = MapRandom::seedFor(mapSeed, EMapStream::pages);
+    uint32_t attempt = 0;
+
     vector<int> excludePageIndices;
     for (int i = 0; i < NUMBER_POINTS_OF_INTEREST - NUM_PAGES; i++) {
-        int pageIndex = rand() % NUMBER_POINTS_OF_INTEREST;
+        int pageIndex = MapRandom::randomInt(seed, attempt++, NUMBER_POINTS_OF_INTEREST);
         while (std::count(excludePageIndices.begin(), excludePageIndices.end(), pageIndex)) {
-            pageIndex = rand() % NUMBER_POINTS_OF_INTEREST;
+            pageIndex = MapRandom::randomInt(seed, attempt++, NUMBER_POINTS_OF_INTEREST);
         }
         excludePageIndices.push_back(pageIndex);
     }
@@ -212,8 +243,8 @@ void MapInitializer::addPOIRenderablesAndStreetLights(const std::map<int, glm::v
             page->setCollected(true);
         }
         pages.push_back(page);
-        renderables.push_back(page);
 
         i += 1;
     }
+    renderables.push_back(new PageBatch(pages));
 }
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Flussi indipendenti ricavati dal seed della mappa, uno per ogni elemento generato
+enum class EMapStream {
+    poi,
+    pages,
+    tree,
+    grass,
+    spawn,
+};
+
+// Generatore basato su contatore: ogni numero e' funzione solo di (seed, indice, stream) e non di uno stato
+// globale, quindi la mappa non dipende dall'ordine di generazione ne' dal numero di thread.
+// Stesso hash di grass_procedural.vs: erba calcolata sulla CPU e nello shader coincidono
+class MapRandom {
+public:
+    static inline uint32_t hash(uint32_t x);
+
+    static inline uint32_t seedFor(const uint32_t mapSeed, const EMapStream stream);
+
+    // Numero casuale in [0, 1)
+    static inline float random(const uint32_t seed, const uint32_t index, const uint32_t stream = 0);
+
+    // Intero casuale in [0, max)
+    static inline int randomInt(const uint32_t seed, const uint32_t index, const int max, const uint32_t stream = 0);
+};
+
+uint32_t MapRandom::hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t MapRandom::seedFor(const uint32_t mapSeed, const EMapStream stream) {
+    return hash(mapSeed ^ hash(static_cast<uint32_t>(stream) + 1));
+}
+
+float MapRandom::random(const uint32_t seed, const uint32_t index, const uint32_t stream) {
+    return static_cast<float>(hash(hash(seed ^ hash(index)) + stream) >> 8) / 16777216.0f;
+}
+
+int MapRandom::randomInt(const uint32_t seed, const uint32_t index, const int max, const uint32_t stream) {
+    return static_cast<int>((hash(hash(seed ^ hash(index)) + stream) >> 8) % static_cast<uint32_t>(max));
+}
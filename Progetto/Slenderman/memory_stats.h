@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gl_resource.h"
+
+// Memoria occupata da un sottosistema: byte residenti sulla CPU e stima dei byte sulla GPU (dal GLResourceRegistry)
+struct MemoryUsage {
+    size_t cpuBytes = 0;
+    size_t gpuBytes = 0;
+
+    inline MemoryUsage& operator+=(const MemoryUsage& other) {
+        cpuBytes += other.cpuBytes;
+        gpuBytes += other.gpuBytes;
+        return *this;
+    }
+};
+
+// Capacita' occupata da un vector, senza gli oggetti a cui puntano i suoi elementi
+template <typename T>
+inline size_t vectorBytes(const std::vector<T>& vector) {
+    return vector.capacity() * sizeof(T);
+}
+
+// Interfaccia comune delle cache e dei sottosistemi che riportano la propria memoria
+class MemoryReporter {
+public:
+    virtual ~MemoryReporter() {}
+
+    virtual MemoryUsage memoryUsage() const = 0;
+};
+
+struct MemoryStatsEntry {
+    std::string name;
+    MemoryUsage usage;
+};
+
+// Registro dei sottosistemi: le cache singleton si registrano alla costruzione, gli altri tra init e destroy.
+// Tutte le chiamate avvengono sul thread GL
+class MemoryStats {
+private:
+    MemoryStats() {}
+
+    std::vector<std::pair<std::string, const MemoryReporter*>> _reporters;
+
+public:
+    MemoryStats(MemoryStats const&) = delete;
+    void operator=(MemoryStats const&) = delete;
+
+    static MemoryStats& getInstance() {
+        static MemoryStats instance;
+        return instance;
+    }
+
+    void add(const std::string& name, const MemoryReporter* reporter);
+
+    void remove(const MemoryReporter* reporter);
+
+    // Una voce per sottosistema, dalla piu' grande (CPU + GPU)
+    std::vector<MemoryStatsEntry> collect() const;
+
+    // Sottosistemi, totali e memoria GL registrata ma non attribuita a nessun sottosistema
+    void writeJson(std::ostream& out) const;
+
+    bool dumpJson(const std::string& path) const;
+};
+
+void MemoryStats::add(const std::string& name, const MemoryReporter* reporter) {
+    remove(reporter);
+    _reporters.push_back({ name, reporter });
+}
+
+void MemoryStats::remove(const MemoryReporter* reporter) {
+    _reporters.erase(std::remove_if(_reporters.begin(), _reporters.end(),
+        [reporter](const std::pair<std::string, const MemoryReporter*>& entry) { return entry.second == reporter; }), _reporters.end());
+}
+
+std::vector<MemoryStatsEntry> MemoryStats::collect() const {
+    std::vector<MemoryStatsEntry> entries;
+    for (const auto& reporter : _reporters)
+        entries.push_back({ reporter.first, reporter.second->memoryUsage() });
+
+    std::stable_sort(entries.begin(), entries.end(), [](const MemoryStatsEntry& a, const MemoryStatsEntry& b) {
+        return a.usage.cpuBytes + a.usage.gpuBytes > b.usage.cpuBytes + b.usage.gpuBytes;
+    });
+    return entries;
+}
+
+void MemoryStats::writeJson(std::ostream& out) const {
+    std::vector<MemoryStatsEntry> entries = collect();
+    MemoryUsage total;
+
+    out << "{" << std::endl << "  \"subsystems\": [" << std::endl;
+    for (size_t i = 0; i < entries.size(); i++) {
+        total += entries[i].usage;
+        out << "    { \"name\": \"" << entries[i].name << "\", \"cpuBytes\": " << entries[i].usage.cpuBytes
+            << ", \"gpuBytes\": " << entries[i].usage.gpuBytes << " }" << (i + 1 < entries.size() ? "," : "") << std::endl;
+    }
+    out << "  ]," << std::endl;
+    out << "  \"total\": { \"cpuBytes\": " << total.cpuBytes << ", \"gpuBytes\": " << total.gpuBytes << " }," << std::endl;
+
+    // I byte GL registrati ma non riportati da nessuno indicano un sottosistema senza MemoryReporter
+    const GLResourceRegistry& registry = GLResourceRegistry::getInstance();
+    size_t trackedBytes = registry.totalBytes();
+    out << "  \"gl\": {" << std::endl;
+    out << "    \"liveObjects\": " << registry.liveObjects() << "," << std::endl;
+    out << "    \"trackedBytes\": " << trackedBytes << "," << std::endl;
+    out << "    \"unattributedBytes\": " << (trackedBytes > total.gpuBytes ? trackedBytes - total.gpuBytes : 0) << "," << std::endl;
+    out << "    \"types\": [" << std::endl;
+    for (int i = 0; i < GL_RESOURCE_TYPES; i++) {
+        const GLResourceStats& stats = registry.stats(static_cast<EGLResource>(i));
+        out << "      { \"type\": \"" << GLResourceRegistry::name(static_cast<EGLResource>(i)) << "\", \"live\": " << stats.live
+            << ", \"bytes\": " << stats.bytes << " }" << (i + 1 < GL_RESOURCE_TYPES ? "," : "") << std::endl;
+    }
+    out << "    ]" << std::endl << "  }" << std::endl << "}" << std::endl;
+}
+
+bool MemoryStats::dumpJson(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file)
+        return false;
+
+    writeJson(file);
+    return static_cast<bool>(file);
+}
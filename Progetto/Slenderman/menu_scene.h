@@ -17,7 +17,7 @@ public:
 
     virtual void init() override;
 
-    virtual void process(const float& deltaTime) override;
+    virtual void process(const FrameClock& clock) override;
 
     virtual void destroy() override;
 
@@ -33,12 +33,12 @@ void MenuScene::_renderMenu() {
 }
 
 void MenuScene::init() {
-    initRenderText(SCR_WIDTH, SCR_HEIGHT);
     if (!ShaderCache::getInstance().has(EShader::fullScreenImage))
         ShaderCache::getInstance().registerShader(EShader::fullScreenImage, new Shader("minimap_shader.vs", "minimap_shader.fs"));
 
     if (!TextureCache::getInstance().has(ETexture::menuImage))
-        TextureCache::getInstance().registerTexture(ETexture::menuImage, "resources/textures/menu_image.jpg");
+        // Immagine a schermo intero mostrata subito: meglio attenderla che mostrare il segnaposto
+        TextureCache::getInstance().registerTexture(ETexture::menuImage, "resources/textures/menu_image.jpg", false);
 
     _menuImage = new FullsceenImage(ETexture::menuImage);
 
@@ -46,7 +46,7 @@ void MenuScene::init() {
         AudioManager::getInstance().loadMusic(EMusic::background, "resources/audio/bg-music.mp3", false);
 }
 
-void MenuScene::process(const float& deltaTime) {
+void MenuScene::process(const FrameClock& clock) {
 
     if (InputManager::isKeyPressed(GLFW_KEY_Q) || InputManager::isKeyPressed(GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(_window, true);
@@ -61,10 +61,10 @@ void MenuScene::process(const float& deltaTime) {
 
     if (InputManager::isKeyPressed(GLFW_KEY_ENTER)) {
         _transitionStarted = true;
-        _transitionStartedTime = glfwGetTime();
+        _transitionStartedTime = clock.time;
     }
 
-    if (_transitionStarted && glfwGetTime() - _transitionStartedTime > 0.3) {
+    if (_transitionStarted && clock.time - _transitionStartedTime > 0.3) {
         _sceneManager->changeScene(EScene::loading);
     }
 }
@@ -6,6 +6,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "gl_resource.h"
 #include "shader_m.h"
 
 #include <string>
@@ -88,21 +89,30 @@ public:
     glActiveTexture(GL_TEXTURE0);
   }
 
+  // Per le mesh copiate in StaticGeometry: i dati restano sulla CPU, i buffer GL non servono piu'
+  void releaseBuffers() {
+    vertexArray.reset();
+    EBO.reset();
+    VBO.reset();
+    VAO = 0;
+  }
+
+  // bytes of the mesh data kept on the CPU and of its own GL buffers (the instance VAOs belong to the renderables)
+  size_t cpuBytes() const {
+    return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) + textures.capacity() * sizeof(Texture);
+  }
+
+  size_t gpuBytes() const {
+    return VBO.bytes() + EBO.bytes();
+  }
+
+  // Le VAO di istanza condividono i buffer di vertici e indici della mesh
   void setupVAOs() {
-      glGenBuffers(1, &VBO);
-      glGenBuffers(1, &EBO);
       for (int k = 0; k < VAOs.size(); k++) {
 
           glBindVertexArray(VAOs[k]);
-          // load data into vertex buffers
-          glBindBuffer(GL_ARRAY_BUFFER, VBO);
-          // A great thing about structs is that their memory layout is sequential for all its items.
-          // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-          // again translates to 3/2 floats which translates to a byte array.
-          glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-          glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+          glBindBuffer(GL_ARRAY_BUFFER, VBO.id());
+          glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.id());
 
           // set the vertex attribute pointers
           // vertex Positions
@@ -121,27 +131,31 @@ public:
 
 private:
   // render data 
-  unsigned int VBO, EBO;
+  GLVertexArray vertexArray;
+  GLBuffer VBO, EBO;
 
 
 
   // initializes all the buffer objects/arrays
   void setupMesh() {
     // create buffers/arrays
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    vertexArray = GLVertexArray::create();
+    VBO = GLBuffer::create();
+    EBO = GLBuffer::create();
+    VAO = vertexArray.id();
 
     glBindVertexArray(VAO);
     // load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.id());
     // A great thing about structs is that their memory layout is sequential for all its items.
     // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
     // again translates to 3/2 floats which translates to a byte array.
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    VBO.setBytes(vertices.size() * sizeof(Vertex));
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.id());
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    EBO.setBytes(indices.size() * sizeof(unsigned int));
 
     // set the vertex attribute pointers
     // vertex Positions
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "constants.h"
+#include "mesh.h"
+
+// Efficienza della cache dei vertici trasformati: ACMR = vertici trasformati per triangolo (ottimo ~0.5),
+// ATVR = vertici trasformati per vertice del buffer (ottimo 1.0)
+struct MeshCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+// Ottimizzazione delle mesh all'import, nell'ordine: saldatura dei vertici identici, ordine dei triangoli per la
+// cache dei vertici (Forsyth), ordine dei cluster di triangoli per l'overdraw e riordino dei vertici per il fetch
+class MeshOptimizer {
+public:
+    static void optimize(vector<Vertex>& vertices, vector<unsigned int>& indices, const std::string& name);
+
+    // Simulazione di una cache FIFO di MESH_OPTIMIZER_CACHE_SIZE vertici
+    static MeshCacheStats analyze(const vector<unsigned int>& indices, const size_t vertexCount);
+
+    static void weldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+    static void optimizeVertexCache(vector<unsigned int>& indices, const size_t vertexCount);
+
+    static void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, const float threshold);
+
+    static void optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+private:
+    // Parametri di "Linear-Speed Vertex Cache Optimisation" (Forsyth)
+    static const int _SCORE_CACHE_SIZE = 32;
+    static const int _MAX_CACHE_SIZE = _SCORE_CACHE_SIZE + 3;
+
+    static float _vertexScore(const int cachePosition, const unsigned int remainingTriangles);
+
+    // Inizio dei cluster in triangoli: un cluster si chiude quando un triangolo non trova nessun vertice in cache
+    static vector<size_t> _clusters(const vector<unsigned int>& indices, const size_t vertexCount);
+};
+
+void MeshOptimizer::optimize(vector<Vertex>& vertices, vector<unsigned int>& indices, const std::string& name) {
+    if (indices.size() < 3 || indices.size() % 3 != 0)
+        return;
+
+    size_t verticesBefore = vertices.size();
+    MeshCacheStats before = analyze(indices, vertices.size());
+
+    weldVertices(vertices, indices);
+    optimizeVertexCache(indices, vertices.size());
+    optimizeOverdraw(indices, vertices, MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+    optimizeVertexFetch(vertices, indices);
+
+    MeshCacheStats after = analyze(indices, vertices.size());
+    std::cout << "Mesh " << name << ": " << indices.size() / 3 << " triangles, vertices " << verticesBefore << " -> " << vertices.size()
+        << ", ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
+
+MeshCacheStats MeshOptimizer::analyze(const vector<unsigned int>& indices, const size_t vertexCount) {
+    MeshCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+
+    // Istante di ingresso in cache di ogni vertice: e' in cache se vi e' entrato meno di CACHE_SIZE miss fa
+    vector<size_t> cacheTimestamps(vertexCount, 0);
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        if (cacheTimestamps[index] == 0 || misses - cacheTimestamps[index] >= MESH_OPTIMIZER_CACHE_SIZE) {
+            misses++;
+            cacheTimestamps[index] = misses;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / (indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / vertexCount;
+    return stats;
+}
+
+void MeshOptimizer::weldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+    // Vertex contiene solo float, il confronto byte per byte equivale all'uguaglianza esatta degli attributi
+    struct VertexHash {
+        size_t operator()(const Vertex* vertex) const {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(vertex);
+            size_t hash = 14695981039346656037ULL;
+            for (size_t i = 0; i < sizeof(Vertex); i++)
+                hash = (hash ^ bytes[i]) * 1099511628211ULL;
+            return hash;
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex* a, const Vertex* b) const { return memcmp(a, b, sizeof(Vertex)) == 0; }
+    };
+
+    std::unordered_map<const Vertex*, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    vector<unsigned int> remap(vertices.size());
+    vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto inserted = unique.insert({ &vertices[i], static_cast<unsigned int>(welded.size()) });
+        if (inserted.second)
+            welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+
+    if (welded.size() == vertices.size())
+        return;
+
+    for (auto& index : indices)
+        index = remap[index];
+    vertices.swap(welded);
+}
+
+float MeshOptimizer::_vertexScore(const int cachePosition, const unsigned int remainingTriangles) {
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // I vertici dell'ultimo triangolo hanno un punteggio fisso per non favorire strip troppo lunghe
+        if (cachePosition < 3)
+            score = 0.75f;
+        else if (cachePosition < _SCORE_CACHE_SIZE)
+            score = std::pow(1.0f - static_cast<float>(cachePosition - 3) / (_SCORE_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // I vertici con pochi triangoli rimasti vanno chiusi presto
+    score += 2.0f / std::sqrt(static_cast<float>(remainingTriangles));
+    return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(vector<unsigned int>& indices, const size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+
+    // Triangoli adiacenti a ogni vertice, compattati in un unico array
+    vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+    vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+    vector<size_t> adjacency(indices.size());
+    vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+
+    vector<int> cachePositions(vertexCount, -1);
+    vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScores[v] = _vertexScore(-1, remaining[v]);
+
+    vector<float> triangleScores(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+    vector<bool> emitted(triangleCount, false);
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    vector<unsigned int> cache;
+    vector<unsigned int> newCache;
+    cache.reserve(_MAX_CACHE_SIZE);
+    newCache.reserve(_MAX_CACHE_SIZE);
+
+    size_t bestTriangle = 0;
+    size_t cursor = 0;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        // Senza candidati tra i vertici in cache si riparte dal primo triangolo non emesso
+        if (bestTriangle == triangleCount) {
+            while (emitted[cursor])
+                cursor++;
+            bestTriangle = cursor;
+        }
+
+        size_t t = bestTriangle;
+        emitted[t] = true;
+        newCache.clear();
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[t * 3 + k];
+            result.push_back(v);
+            newCache.push_back(v);
+
+            // Il triangolo esce dalle adiacenze del vertice
+            size_t begin = adjacencyOffsets[v];
+            size_t end = begin + remaining[v];
+            for (size_t a = begin; a < end; a++) {
+                if (adjacency[a] == t) {
+                    adjacency[a] = adjacency[end - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+        for (unsigned int v : cache)
+            if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+                newCache.push_back(v);
+        if (newCache.size() > _MAX_CACHE_SIZE)
+            newCache.resize(_MAX_CACHE_SIZE);
+        for (unsigned int v : cache)
+            cachePositions[v] = -1;
+        cache.swap(newCache);
+
+        // Oltre _SCORE_CACHE_SIZE i vertici perdono il bonus di posizione prima di uscire dalla cache.
+        // Aggiorna i punteggi dei vertici in cache e cerca il prossimo triangolo tra i loro adiacenti
+        for (size_t i = 0; i < cache.size(); i++) {
+            unsigned int v = cache[i];
+            cachePositions[v] = i < static_cast<size_t>(_SCORE_CACHE_SIZE) ? static_cast<int>(i) : -1;
+        }
+        float bestScore = -1.0f;
+        bestTriangle = triangleCount;
+        for (unsigned int v : cache) {
+            float score = _vertexScore(cachePositions[v], remaining[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+
+            size_t begin = adjacencyOffsets[v];
+            for (size_t a = begin; a < begin + remaining[v]; a++) {
+                size_t adjacent = adjacency[a];
+                triangleScores[adjacent] += delta;
+                if (triangleScores[adjacent] > bestScore) {
+                    bestScore = triangleScores[adjacent];
+                    bestTriangle = adjacent;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+vector<size_t> MeshOptimizer::_clusters(const vector<unsigned int>& indices, const size_t vertexCount) {
+    vector<size_t> clusters;
+    vector<size_t> cacheTimestamps(vertexCount, 0);
+    size_t misses = 0;
+    for (size_t t = 0; t < indices.size() / 3; t++) {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int index = indices[t * 3 + k];
+            if (cacheTimestamps[index] == 0 || misses - cacheTimestamps[index] >= MESH_OPTIMIZER_CACHE_SIZE) {
+                misses++;
+                triangleMisses++;
+                cacheTimestamps[index] = misses;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusters.push_back(t);
+    }
+    return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, const float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    vector<size_t> clusters = _clusters(indices, vertices.size());
+    if (clusters.size() < 2)
+        return;
+    clusters.push_back(triangleCount);
+
+    glm::vec3 meshCentroid(0.0f);
+    for (const auto& vertex : vertices)
+        meshCentroid += vertex.Position;
+    meshCentroid /= static_cast<float>(vertices.size());
+
+    // I cluster rivolti verso l'esterno e lontani dal centro coprono il resto della mesh: vanno disegnati per primi
+    vector<std::pair<float, size_t>> order;
+    for (size_t c = 0; c + 1 < clusters.size(); c++) {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float areaSum = 0.0f;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& p = vertices[indices[t * 3 + 2]].Position;
+            // Normale non normalizzata: pesa i triangoli per area
+            glm::vec3 areaNormal = glm::cross(b - a, p - a);
+            float area = glm::length(areaNormal);
+            normal += areaNormal;
+            centroid += (a + b + p) / 3.0f * area;
+            areaSum += area;
+        }
+        // Centroide pesato per area e direzione media del cluster: le normali opposte di un cluster chiuso si annullano
+        float sortKey = 0.0f;
+        if (areaSum > 0.0f && glm::length(normal) > 0.0f)
+            sortKey = glm::dot(centroid / areaSum - meshCentroid, glm::normalize(normal));
+        order.push_back({ sortKey, c });
+    }
+    std::stable_sort(order.begin(), order.end(), [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) { return a.first > b.first; });
+
+    vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (const auto& cluster : order)
+        result.insert(result.end(), indices.begin() + clusters[cluster.second] * 3, indices.begin() + clusters[cluster.second + 1] * 3);
+
+    // Il riordino non deve costare piu' di threshold volte l'ACMR ottenuto per la cache
+    if (analyze(result, vertices.size()).acmr <= analyze(indices, vertices.size()).acmr * threshold)
+        indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+    // Vertici nell'ordine del primo utilizzo, quelli non referenziati vengono scartati
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (auto& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
@@ -6,6 +6,7 @@
 #include "glm/glm.hpp"
 
 #include "constants.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "texture_cache.h"
 #include "shader_cache.h"
@@ -29,21 +30,21 @@ private:
 public:
     Minimap(const std::map<int, glm::vec3>& poiInfo);
 
+    // I marker sono l'unica parte che cambia tra una partita e l'altra
+    void setPointsOfInterest(const std::map<int, glm::vec3>& poiInfo);
+
     ~Minimap() {
         _circleTransforms.clear();
         _circleTransforms.shrink_to_fit();
     }
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
 Minimap::Minimap(const std::map<int, glm::vec3>& poiInfo) {
-    for (auto poi : poiInfo) {
-        glm::mat4 transform = glm::mat4(1.0f);
-        transform = glm::translate(transform, glm::vec3(-poi.second.x / MAX_W_QUAD_MAP, poi.second.z / MAX_W_QUAD_MAP, 0.0f));
-        transform = glm::scale(transform, glm::vec3(0.03f, 0.03f, 0.03f));
-        _circleTransforms.push_back(transform);
-    }
+    setPointsOfInterest(poiInfo);
 
     _texture = TextureCache::getInstance().findTexture(ETexture::minimap);
 
@@ -55,6 +56,16 @@ Minimap::Minimap(const std::map<int, glm::vec3>& poiInfo) {
     _initMinimapMarkers();
 }
 
+void Minimap::setPointsOfInterest(const std::map<int, glm::vec3>& poiInfo) {
+    _circleTransforms.clear();
+    for (auto poi : poiInfo) {
+        glm::mat4 transform = glm::mat4(1.0f);
+        transform = glm::translate(transform, glm::vec3(-poi.second.x / MAX_W_QUAD_MAP, poi.second.z / MAX_W_QUAD_MAP, 0.0f));
+        transform = glm::scale(transform, glm::vec3(0.03f, 0.03f, 0.03f));
+        _circleTransforms.push_back(transform);
+    }
+}
+
 void Minimap::_initMinimap() {
     const float MAP_W_PROP_DIMENSION = MAP_DIMENSION * 2 / (float)SCR_WIDTH;
     const float MAP_H_PROP_DIMENSION = MAP_DIMENSION * 2 / (float)SCR_HEIGHT;
@@ -72,10 +83,8 @@ void Minimap::_initMinimap() {
            1.0f - MAP_W_PROP_OFFSET                       , -(1.0f - MAP_H_PROP_DIMENSION - MAP_H_PROP_OFFSET),  0.0f, 0.0f
     };
 
-    unsigned int minimapVAO;
-    unsigned int minimapVBO;
-    glGenVertexArrays(1, &minimapVAO);
-    glGenBuffers(1, &minimapVBO);
+    unsigned int minimapVAO = _glResources.vertexArray();
+    unsigned int minimapVBO = _glResources.buffer(sizeof(minimapVertices));
     glBindVertexArray(minimapVAO);
     glBindBuffer(GL_ARRAY_BUFFER, minimapVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(minimapVertices), &minimapVertices, GL_STATIC_DRAW);
@@ -86,13 +95,11 @@ void Minimap::_initMinimap() {
 
 
     // framebuffer
-    unsigned int framebuffer;
-    glGenFramebuffers(1, &framebuffer);
+    unsigned int framebuffer = _glResources.framebuffer();
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
     // create a color attachment texture
-    unsigned int textureColorBuffer;
-    glGenTextures(1, &textureColorBuffer);
+    unsigned int textureColorBuffer = _glResources.texture(GLResourceRegistry::textureBytes(SCR_WIDTH, SCR_HEIGHT, 3));
     glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -100,8 +107,7 @@ void Minimap::_initMinimap() {
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorBuffer, 0);
 
     // create a renderbuffer object for depth and stencil attachment 
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
+    unsigned int rbo = _glResources.renderbuffer(GLResourceRegistry::textureBytes(SCR_WIDTH, SCR_HEIGHT, 4));
     glBindRenderbuffer(GL_RENDERBUFFER, rbo);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
@@ -123,10 +129,8 @@ void Minimap::_initMinimap() {
          1.0f,  1.0f,  1.0f, 1.0f
     };
 
-    unsigned int minimapWoodVAO;
-    unsigned int minimapWoodVBO;
-    glGenVertexArrays(1, &minimapWoodVAO);
-    glGenBuffers(1, &minimapWoodVBO);
+    unsigned int minimapWoodVAO = _glResources.vertexArray();
+    unsigned int minimapWoodVBO = _glResources.buffer(sizeof(minimapWoodVertices));
     glBindVertexArray(minimapWoodVAO);
     glBindBuffer(GL_ARRAY_BUFFER, minimapWoodVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(minimapWoodVertices), &minimapWoodVertices, GL_STATIC_DRAW);
@@ -171,10 +175,8 @@ void Minimap::_initMinimapMarkers() {
         prevY = newY;
     }
 
-    unsigned int circleVAO;
-    unsigned int circleVBO;
-    glGenVertexArrays(1, &circleVAO);
-    glGenBuffers(1, &circleVBO);
+    unsigned int circleVAO = _glResources.vertexArray();
+    unsigned int circleVBO = _glResources.buffer(sizeof(circleVertices));
     glBindVertexArray(circleVAO);
     glBindBuffer(GL_ARRAY_BUFFER, circleVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(circleVertices), &circleVertices, GL_STATIC_DRAW);
@@ -190,10 +192,8 @@ void Minimap::_initMinimapMarkers() {
          0.5f, -0.7f
     };
 
-    unsigned int personVAO;
-    unsigned int personVBO;
-    glGenVertexArrays(1, &personVAO);
-    glGenBuffers(1, &personVBO);
+    unsigned int personVAO = _glResources.vertexArray();
+    unsigned int personVBO = _glResources.buffer(sizeof(personMarkerVertices));
     glBindVertexArray(personVAO);
     glBindBuffer(GL_ARRAY_BUFFER, personVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(personMarkerVertices), &personMarkerVertices, GL_STATIC_DRAW);
@@ -204,21 +204,24 @@ void Minimap::_initMinimapMarkers() {
 }
 
 void Minimap::_buildMinimap(const Camera& camera) {
+    GLStateCache& stateCache = GLStateCache::getInstance();
+
     glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
-    glDisable(GL_DEPTH_TEST);
+    stateCache.disable(GL_DEPTH_TEST);
     glClearColor(0.137f, 0.09f, 0.035f, 0.8f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    _minimapWoodShader->use();
-    glBindTexture(GL_TEXTURE_2D, _texture);
-    glBindVertexArray(_minimapWoodVAO);
+    stateCache.useProgram(_minimapWoodShader->ID);
+    stateCache.bindTexture(0, _texture);
+    TextureStreamer::getInstance().touch(_texture);
+    stateCache.bindVertexArray(_minimapWoodVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 
-    _minimapCircleShader->use();
+    stateCache.useProgram(_minimapCircleShader->ID);
+    stateCache.bindVertexArray(_circleVAO);
     for (auto& const transform : _circleTransforms) {
         _minimapCircleShader->setMat4("transform", transform);
         _minimapCircleShader->setVec3("circleColor", glm::vec3(1.0f, 0.8f, 0.0f));
-        glBindVertexArray(_circleVAO);
         glDrawArrays(GL_TRIANGLES, 0, NUM_VERTICES_CIRCLE / 2);
     }
 
@@ -232,21 +235,29 @@ void Minimap::_buildMinimap(const Camera& camera) {
     _minimapCircleShader->setMat4("transform", transform);
     _minimapCircleShader->setVec3("circleColor", glm::vec3(1.0f, 0.0f, 0.0f));
 
-    glBindVertexArray(_personVAO);
+    stateCache.bindVertexArray(_personVAO);
     glDrawArrays(GL_TRIANGLES, 0, 3);
 
-    glEnable(GL_DEPTH_TEST);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void Minimap::render(const Camera& camera, const LightUtils& lightUtils) {
+void Minimap::submit(RenderQueue& queue, const Camera& camera) {
+    // Il pacchetto non porta stato: la minimappa cambia framebuffer e programma durante il disegno
+    DrawPacket packet;
+    packet.pass = ERenderPass::overlay;
+    packet.owner = this;
+    queue.submit(packet);
+}
+
+void Minimap::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    GLStateCache& stateCache = GLStateCache::getInstance();
+
     _buildMinimap(camera);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDisable(GL_DEPTH_TEST);
-    _shader->use();
-    glBindVertexArray(_VAO);
-    glBindTexture(GL_TEXTURE_2D, _textureColorBuffer);
+    stateCache.disable(GL_DEPTH_TEST);
+    stateCache.useProgram(_shader->ID);
+    stateCache.bindVertexArray(_VAO);
+    stateCache.bindTexture(0, _textureColorBuffer);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glEnable(GL_DEPTH_TEST);
+    stateCache.enable(GL_DEPTH_TEST);
 }
\ No newline at end of file
@@ -10,8 +10,12 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "constants.h"
+#include "gl_resource.h"
 #include "mesh.h"
+#include "mesh_optimizer.h"
 #include "shader_m.h"
+#include "texture_upload_queue.h"
 
 
 #include <string>
@@ -47,7 +51,29 @@ public:
       }
   }
 
+  // bytes of the meshes on the CPU, and of the mesh buffers and the model textures on the GPU
+  size_t cpuBytes() const
+  {
+    size_t bytes = 0;
+    for (const auto& mesh : meshes)
+      bytes += mesh.cpuBytes();
+    return bytes + textures_loaded.capacity() * sizeof(Texture);
+  }
+
+  size_t gpuBytes() const
+  {
+    size_t bytes = 0;
+    for (const auto& mesh : meshes)
+      bytes += mesh.gpuBytes();
+    for (const auto& texture : textureHandles)
+      bytes += texture.bytes();
+    return bytes;
+  }
+
 private:
+  // owns the textures in textures_loaded, deleted together with the model
+  vector<GLTexture> textureHandles;
+
   // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
   void loadModel(string const& path)
   {
@@ -144,6 +170,10 @@ private:
       for (unsigned int j = 0; j < face.mNumIndices; j++)
         indices.push_back(face.mIndices[j]);
     }
+    // weld, reorder for the vertex cache and overdraw, then for vertex fetch
+    if (USE_MESH_OPTIMIZATION)
+      MeshOptimizer::optimize(vertices, indices, directory + "/" + mesh->mName.C_Str());
+
     // process materials
     aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
     // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -198,6 +228,7 @@ private:
         texture.path = str.C_Str();
         textures.push_back(texture);
         textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        textureHandles.push_back(GLTexture(texture.id));
       }
     }
     return textures;
@@ -210,43 +241,8 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
   string filename = string(path);
   filename = directory + '/' + filename;
 
-  unsigned int textureID;
-  glGenTextures(1, &textureID);
-
-  int width, height, nrComponents;
-  unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-  if (data)
-  {
-    GLenum format;
-    if (nrComponents == 1)
-      format = GL_RED;
-    else if (nrComponents == 3)
-      format = GL_RGB;
-    else if (nrComponents == 4)
-      format = GL_RGBA;
-    else {
-        stbi_image_free(data);
-        return textureID;
-    }
-
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    stbi_image_free(data);
-  }
-  else
-  {
-    std::cout << "Texture failed to load at path: " << path << std::endl;
-    stbi_image_free(data);
-  }
-
-  return textureID;
+  // Decodifica e caricamento avvengono in background, l'handle e' valido da subito
+  return TextureUploadQueue::getInstance().enqueue(filename);
 }
 #endif
 
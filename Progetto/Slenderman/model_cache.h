@@ -2,6 +2,7 @@
 
 #include <map>
 
+#include "memory_stats.h"
 #include "model.h"
 
 enum class EModel {
@@ -20,11 +21,11 @@ enum class EModel {
     fence
 };
 
-class ModelCache {
+class ModelCache : public MemoryReporter {
 private:
     std::map<EModel, Model*> _modelCache;
 
-    ModelCache() {}
+    ModelCache() { MemoryStats::getInstance().add("models", this); }
 
 public:
     ModelCache(ModelCache const&) = delete;
@@ -39,6 +40,8 @@ public:
     void clear();
 
     inline bool has(EModel key) const { return _modelCache.find(key) != _modelCache.end(); } 
+
+    virtual MemoryUsage memoryUsage() const override;
 };
 
 ModelCache& ModelCache::getInstance() {
@@ -57,6 +60,15 @@ Model* ModelCache::findModel(EModel key) {
     return _modelCache[key];
 }
 
+MemoryUsage ModelCache::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& pair : _modelCache) {
+        usage.cpuBytes += sizeof(Model) + pair.second->cpuBytes();
+        usage.gpuBytes += pair.second->gpuBytes();
+    }
+    return usage;
+}
+
 void ModelCache::clear() {
     for (auto pair : _modelCache)
         delete pair.second;
@@ -2,19 +2,42 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 aInstanceMatrix;
+layout (location = 3) in vec3 aInstancePosition;
+layout (location = 4) in vec2 aInstanceYawScale;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
+// proporzioni della scala comuni a tutte le istanze
+uniform vec3 scaleAxes = vec3(1.0);
 
 void main()
 {
-    FragPos = vec3(aInstanceMatrix * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(aInstanceMatrix))) * aNormal;  
+    float c = cos(aInstanceYawScale.x);
+    float s = sin(aInstanceYawScale.x);
+    vec3 scale = aInstanceYawScale.y * scaleAxes;
+
+    // model = T * S * R_y
+    mat4 instanceMatrix = mat4(
+        vec4(scale.x * c, 0.0, -scale.z * s, 0.0),
+        vec4(0.0, scale.y, 0.0, 0.0),
+        vec4(scale.x * s, 0.0, scale.z * c, 0.0),
+        vec4(aInstancePosition, 1.0));
+
+    FragPos = vec3(instanceMatrix * vec4(aPos, 1.0));
+    // Per model = T * S * R_y la matrice delle normali e' S^-1 * R_y: la rotazione si applica
+    // direttamente e la scala viene invertita, senza calcolare l'inversa completa per vertice
+    vec3 rotatedNormal = vec3(c * aNormal.x + s * aNormal.z, aNormal.y, -s * aNormal.x + c * aNormal.z);
+    Normal = rotatedNormal / scale;
     TexCoords = aTexCoords;   
-    gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
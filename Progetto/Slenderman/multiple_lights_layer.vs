@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out float Layer;
+
+uniform mat4 model;
+// transpose(inverse(mat3(model))), calcolata sulla CPU
+uniform mat3 normalMatrix;
+// layer della texture array, -1 per usare la texture 2D
+uniform float layer = -1.0;
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = normalMatrix * aNormal;
+    TexCoords = aTexCoords;
+    Layer = layer;
+    
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
\ No newline at end of file
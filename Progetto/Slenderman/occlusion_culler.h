@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "constants.h"
+#include "frame_constants.h"
+#include "gl_resource.h"
+#include "memory_stats.h"
+#include "model.h"
+#include "shader_cache.h"
+
+// Volume allineato agli assi in coordinate del mondo
+struct CullBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    // Bounding degli 8 vertici trasformati
+    CullBounds transformed(const glm::mat4& transform) const;
+
+    static CullBounds fromModel(const Model& model);
+};
+
+enum class EOcclusionGroup {
+    chunk = 0,
+    object = 1
+};
+
+struct OcclusionStats {
+    unsigned int tested[2] = {};
+    unsigned int outsideFrustum[2] = {};
+    unsigned int occluded[2] = {};
+
+    inline unsigned int drawn(const EOcclusionGroup group) const {
+        int i = static_cast<int>(group);
+        return tested[i] - outsideFrustum[i] - occluded[i];
+    }
+};
+
+// Occlusion culling gerarchico sulla profondita' dei frame precedenti.
+// Dopo la geometria opaca la depth della scena viene ridotta sulla GPU a HI_Z_WIDTH x HI_Z_HEIGHT (massimo per texel)
+// e letta in modo asincrono con PBO e fence; la CPU costruisce i livelli successivi della piramide.
+// Le renderable testano i propri volumi in submit, prima contro il frustum del frame corrente (FrameConstants)
+// e poi contro la piramide: un volume e' nascosto se il suo punto piu' vicino alla camera
+// e' oltre la profondita' massima dell'area che copre sullo schermo. Il test usa la camera del frame misurato:
+// un oggetto che diventa visibile puo' comparire con HI_Z_READBACK_FRAMES frame di ritardo
+class OcclusionCuller : public MemoryReporter {
+private:
+    OcclusionCuller() { MemoryStats::getInstance().add("occlusion culling", this); }
+
+    GLTexture _depthTexture;
+    GLFramebuffer _depthFramebuffer;
+    GLTexture _reduceTexture;
+    GLFramebuffer _reduceFramebuffer;
+    GLVertexArray _emptyVAO;
+    Shader* _reduceShader = nullptr;
+
+    GLBuffer _PBOs[HI_Z_READBACK_FRAMES];
+    GLsync _PBOFences[HI_Z_READBACK_FRAMES] = {};
+    glm::mat4 _PBOViewProjections[HI_Z_READBACK_FRAMES];
+    glm::mat4 _PBOProjections[HI_Z_READBACK_FRAMES];
+    unsigned int _PBOIndex = 0;
+
+    // Piramide sulla CPU, livello 0 = profondita' letta dalla GPU
+    std::vector<std::vector<float>> _levels;
+    std::vector<glm::ivec2> _levelSizes;
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+    glm::mat4 _projection = glm::mat4(1.0f);
+    bool _valid = false;
+
+    OcclusionStats _currentStats;
+    OcclusionStats _lastFrameStats;
+
+    void _init();
+    // Legge il PBO che sta per essere riusato, false se la GPU non l'ha ancora riempito
+    bool _readBack();
+    void _buildPyramid();
+    float _maxDepth(const int level, const int x0, const int y0, const int x1, const int y1) const;
+
+public:
+    OcclusionCuller(OcclusionCuller const&) = delete;
+    void operator=(OcclusionCuller const&) = delete;
+
+    static OcclusionCuller& getInstance() {
+        static OcclusionCuller instance;
+        return instance;
+    }
+
+    // Con il framebuffer della scena collegato, dopo la geometria opaca. Ripristina framebuffer e viewport
+    void capture(const unsigned int framebuffer, const int width, const int height, const glm::mat4& viewProjection, const glm::mat4& projection);
+
+    // Dopo FrameConstantsBuffer::update. Senza una piramide valida si usa solo il frustum
+    bool isVisible(const CullBounds& bounds, const EOcclusionGroup group);
+
+    // La profondita' misurata non vale piu' (nuova partita, camera spostata)
+    void invalidate();
+
+    inline const OcclusionStats& lastFrameStats() const { return _lastFrameStats; }
+
+    virtual MemoryUsage memoryUsage() const override;
+
+    void destroy();
+};
+
+CullBounds CullBounds::transformed(const glm::mat4& transform) const {
+    CullBounds result;
+    result.min = glm::vec3(FLT_MAX);
+    result.max = glm::vec3(-FLT_MAX);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+        glm::vec3 point = glm::vec3(transform * glm::vec4(corner, 1.0f));
+        result.min = glm::min(result.min, point);
+        result.max = glm::max(result.max, point);
+    }
+    return result;
+}
+
+CullBounds CullBounds::fromModel(const Model& model) {
+    CullBounds result;
+    result.min = glm::vec3(FLT_MAX);
+    result.max = glm::vec3(-FLT_MAX);
+    for (const auto& mesh : model.meshes) {
+        for (const auto& vertex : mesh.vertices) {
+            result.min = glm::min(result.min, vertex.Position);
+            result.max = glm::max(result.max, vertex.Position);
+        }
+    }
+    return result;
+}
+
+void OcclusionCuller::_init() {
+    _reduceShader = ShaderCache::getInstance().findShader(EShader::hiZReduce);
+
+    // Stesso formato del depth/stencil della scena, richiesto da glBlitFramebuffer
+    _depthTexture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, _depthTexture.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    _depthTexture.setBytes(GLResourceRegistry::textureBytes(SCR_WIDTH, SCR_HEIGHT, 4));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    _depthFramebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, _depthFramebuffer.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, _depthTexture.id(), 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Hi-Z depth framebuffer is not complete!" << std::endl;
+
+    _reduceTexture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, _reduceTexture.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, HI_Z_WIDTH, HI_Z_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    _reduceTexture.setBytes(GLResourceRegistry::textureBytes(HI_Z_WIDTH, HI_Z_HEIGHT, 4));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    _reduceFramebuffer = GLFramebuffer::create();
+    glBindFramebuffer(GL_FRAMEBUFFER, _reduceFramebuffer.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _reduceTexture.id(), 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::FRAMEBUFFER:: Hi-Z reduction framebuffer is not complete!" << std::endl;
+
+    _emptyVAO = GLVertexArray::create();
+
+    size_t bytes = HI_Z_WIDTH * HI_Z_HEIGHT * sizeof(float);
+    for (auto& PBO : _PBOs) {
+        PBO = GLBuffer::create();
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBO.id());
+        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+        PBO.setBytes(bytes);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    _levels.assign(1, std::vector<float>(HI_Z_WIDTH * HI_Z_HEIGHT, 1.0f));
+    _levelSizes.assign(1, glm::ivec2(HI_Z_WIDTH, HI_Z_HEIGHT));
+}
+
+bool OcclusionCuller::_readBack() {
+    GLsync fence = _PBOFences[_PBOIndex];
+    if (fence == 0)
+        return true;
+
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        return false;
+    glDeleteSync(fence);
+    _PBOFences[_PBOIndex] = 0;
+
+    size_t bytes = HI_Z_WIDTH * HI_Z_HEIGHT * sizeof(float);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _PBOs[_PBOIndex].id());
+    void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (mapped != nullptr) {
+        memcpy(_levels[0].data(), mapped, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        _viewProjection = _PBOViewProjections[_PBOIndex];
+        _projection = _PBOProjections[_PBOIndex];
+        _buildPyramid();
+        _valid = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+void OcclusionCuller::_buildPyramid() {
+    _levels.resize(1);
+    _levelSizes.resize(1);
+
+    while (_levelSizes.back().x > 1 || _levelSizes.back().y > 1) {
+        const std::vector<float>& source = _levels.back();
+        glm::ivec2 sourceSize = _levelSizes.back();
+        // Arrotondando per eccesso il texel dispari finisce nell'ultimo texel del livello successivo
+        glm::ivec2 size((sourceSize.x + 1) / 2, (sourceSize.y + 1) / 2);
+
+        std::vector<float> level(static_cast<size_t>(size.x) * size.y);
+        for (int y = 0; y < size.y; y++) {
+            int y0 = 2 * y;
+            int y1 = std::min(y0 + 1, sourceSize.y - 1);
+            for (int x = 0; x < size.x; x++) {
+                int x0 = 2 * x;
+                int x1 = std::min(x0 + 1, sourceSize.x - 1);
+                level[y * size.x + x] = std::max(std::max(source[y0 * sourceSize.x + x0], source[y0 * sourceSize.x + x1]),
+                    std::max(source[y1 * sourceSize.x + x0], source[y1 * sourceSize.x + x1]));
+            }
+        }
+
+        _levels.push_back(std::move(level));
+        _levelSizes.push_back(size);
+    }
+}
+
+float OcclusionCuller::_maxDepth(const int level, const int x0, const int y0, const int x1, const int y1) const {
+    const std::vector<float>& depths = _levels[level];
+    int width = _levelSizes[level].x;
+
+    float depth = 0.0f;
+    for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            depth = std::max(depth, depths[y * width + x]);
+    return depth;
+}
+
+void OcclusionCuller::capture(const unsigned int framebuffer, const int width, const int height, const glm::mat4& viewProjection, const glm::mat4& projection) {
+    _lastFrameStats = _currentStats;
+    _currentStats = OcclusionStats();
+
+    if (!_reduceFramebuffer)
+        _init();
+
+    // Il PBO di questo slot non e' ancora pronto: si salta la misura del frame invece di bloccare
+    if (!_readBack())
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _depthFramebuffer.id());
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _reduceFramebuffer.id());
+    glViewport(0, 0, HI_Z_WIDTH, HI_Z_HEIGHT);
+    glDisable(GL_DEPTH_TEST);
+
+    _reduceShader->use();
+    _reduceShader->setInt("depthTexture", 0);
+    glUniform2i(glGetUniformLocation(_reduceShader->ID, "sourceSize"), width, height);
+    glUniform2i(glGetUniformLocation(_reduceShader->ID, "targetSize"), HI_Z_WIDTH, HI_Z_HEIGHT);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, _depthTexture.id());
+    glBindVertexArray(_emptyVAO.id());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // Con un PBO collegato la lettura e' asincrona, i dati si leggono quando lo slot torna in uso
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, _PBOs[_PBOIndex].id());
+    glReadPixels(0, 0, HI_Z_WIDTH, HI_Z_HEIGHT, GL_RED, GL_FLOAT, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    _PBOFences[_PBOIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _PBOViewProjections[_PBOIndex] = viewProjection;
+    _PBOProjections[_PBOIndex] = projection;
+    _PBOIndex = (_PBOIndex + 1) % HI_Z_READBACK_FRAMES;
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+bool OcclusionCuller::isVisible(const CullBounds& bounds, const EOcclusionGroup group) {
+    int groupIndex = static_cast<int>(group);
+    _currentStats.tested[groupIndex]++;
+
+    // Vertice del volume piu' avanti lungo la normale di ogni piano: se e' fuori, lo e' tutto il volume
+    for (const auto& plane : FrameConstantsBuffer::getInstance().constants().frustumPlanes) {
+        glm::vec3 positive(plane.x >= 0.0f ? bounds.max.x : bounds.min.x, plane.y >= 0.0f ? bounds.max.y : bounds.min.y, plane.z >= 0.0f ? bounds.max.z : bounds.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+            _currentStats.outsideFrustum[groupIndex]++;
+            return false;
+        }
+    }
+
+    if (!_valid)
+        return true;
+
+    glm::vec2 ndcMin(FLT_MAX);
+    glm::vec2 ndcMax(-FLT_MAX);
+    float nearest = FLT_MAX;
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x, (i & 2) ? bounds.max.y : bounds.min.y, (i & 4) ? bounds.max.z : bounds.min.z);
+        glm::vec4 clip = _viewProjection * glm::vec4(corner, 1.0f);
+        // Il volume attraversa il piano vicino: la proiezione non e' affidabile
+        if (clip.w <= 0.1f)
+            return true;
+
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+        nearest = std::min(nearest, clip.w);
+    }
+
+    // Fuori dalla vista misurata non si sa cosa ci sia davanti
+    if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+        return true;
+
+    // Texel del livello 0 toccati dall'area, estremi compresi
+    int x0 = std::max(0, static_cast<int>((ndcMin.x * 0.5f + 0.5f) * HI_Z_WIDTH));
+    int x1 = std::min(HI_Z_WIDTH - 1, static_cast<int>((ndcMax.x * 0.5f + 0.5f) * HI_Z_WIDTH));
+    int y0 = std::max(0, static_cast<int>((ndcMin.y * 0.5f + 0.5f) * HI_Z_HEIGHT));
+    int y1 = std::min(HI_Z_HEIGHT - 1, static_cast<int>((ndcMax.y * 0.5f + 0.5f) * HI_Z_HEIGHT));
+
+    // Livello in cui l'area copre al massimo 4x4 texel
+    int level = 0;
+    while ((x1 - x0 > 3 || y1 - y0 > 3) && level + 1 < static_cast<int>(_levels.size())) {
+        x0 /= 2;
+        x1 /= 2;
+        y0 /= 2;
+        y1 /= 2;
+        level++;
+    }
+
+    float depth = _maxDepth(level, x0, y0, x1, y1);
+    if (depth >= 1.0f)
+        return true;
+
+    // Dalla profondita' [0, 1] alla distanza lungo l'asse della camera, la stessa misura di clip.w
+    float occluderDistance = _projection[3][2] / (depth * 2.0f - 1.0f + _projection[2][2]);
+    if (nearest <= occluderDistance + HI_Z_DEPTH_MARGIN)
+        return true;
+
+    _currentStats.occluded[groupIndex]++;
+    return false;
+}
+
+void OcclusionCuller::invalidate() {
+    _valid = false;
+    for (auto& fence : _PBOFences) {
+        if (fence != 0)
+            glDeleteSync(fence);
+        fence = 0;
+    }
+}
+
+MemoryUsage OcclusionCuller::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& level : _levels)
+        usage.cpuBytes += vectorBytes(level);
+    usage.cpuBytes += vectorBytes(_levelSizes);
+    usage.gpuBytes = _depthTexture.bytes() + _reduceTexture.bytes();
+    for (const auto& PBO : _PBOs)
+        usage.gpuBytes += PBO.bytes();
+    return usage;
+}
+
+void OcclusionCuller::destroy() {
+    invalidate();
+    _levels.clear();
+    _levelSizes.clear();
+    for (auto& PBO : _PBOs)
+        PBO.reset();
+    _emptyVAO.reset();
+    _reduceFramebuffer.reset();
+    _reduceTexture.reset();
+    _depthFramebuffer.reset();
+    _depthTexture.reset();
+    _reduceShader = nullptr;
+}
@@ -1,19 +1,24 @@
 #pragma once
 
+#include <cstring>
+#include <vector>
+
 #include "constants.h"
 #include "light_utils.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_m.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
 
-class Page : public VAORenderable {
+// Stato di una pagina: le pagine vengono disegnate tutte insieme da PageBatch
+class Page {
 private:
     bool _collected = false;
     bool _framed = true;
 
-    Shader* _shaderSingleColor;
-
+    TextureLayer _layer;
+    glm::mat4 _transform;
     glm::mat4 _singleColorTransform;
     glm::vec3 _relatedPOITranslation;
 
@@ -21,21 +26,48 @@ public:
     Page(ETexture texture, glm::vec3 poiTranslation);
 
     inline void setFramed(bool framed);
+    inline bool isFramed() const { return _framed; }
 
     inline bool isCollected();
     inline void setCollected(bool collected);
 
     inline const glm::vec3& getRelatedPOITranslation() const;
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    inline const TextureLayer& layer() const { return _layer; }
+
+    inline const glm::mat4& transform() const { return _transform; }
+
+    inline const glm::mat4& singleColorTransform() const { return _singleColorTransform; }
+};
+
+// Record per istanza di page_instancing.vs
+struct PageInstance {
+    glm::mat4 model;
+    float layer;
+};
+
+// Tutte le pagine non raccolte in una sola chiamata istanziata: le texture sono layer dello stesso array
+class PageBatch : public VAORenderable {
+private:
+    const std::vector<Page*>& _pages;
+    Shader* _shaderSingleColor;
+    unsigned int _instanceVBO;
+
+    std::vector<PageInstance> _instances;
+    std::vector<PageInstance> _uploadedInstances;
+    const Page* _framedPage = nullptr;
+
+public:
+    PageBatch(const std::vector<Page*>& pages);
+
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
 Page::Page(ETexture texture, glm::vec3 poiTranslation) {
-    _texture = TextureCache::getInstance().findTexture(texture);
-    _shader = ShaderCache::getInstance().findShader(EShader::page);
-    _shaderSingleColor = ShaderCache::getInstance().findShader(EShader::singleColor);
+    _layer = TextureCache::getInstance().findLayer(texture);
     _relatedPOITranslation = poiTranslation;
-    _VAO = VAORenderable::_initRectVAO(1.0f);
 
     glm::mat4 transform = glm::mat4(1.0f);
     //TODO: Decidere se la pagina deve essere attaccata al lampione o al punto di interesse
@@ -68,51 +100,94 @@ inline const glm::vec3& Page::getRelatedPOITranslation() const {
     return _relatedPOITranslation;
 }
 
-void Page::render(const Camera& camera, const LightUtils& lightUtils) {
-    if (_collected)
+PageBatch::PageBatch(const std::vector<Page*>& pages) : _pages(pages) {
+    _shader = ShaderCache::getInstance().findShader(EShader::page);
+    _shaderSingleColor = ShaderCache::getInstance().findShader(EShader::singleColor);
+    _texture = 0;
+    _VAO = _initRectVAO(1.0f);
+
+    size_t bytes = _pages.size() * sizeof(PageInstance);
+    _instanceVBO = _glResources.buffer(bytes);
+    glBindVertexArray(_VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+
+    // mat4 per istanza: una colonna per location
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(PageInstance), (void*)(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(PageInstance), (void*)offsetof(PageInstance, layer));
+    glVertexAttribDivisor(7, 1);
+
+    glBindVertexArray(0);
+}
+
+void PageBatch::submit(RenderQueue& queue, const Camera& camera) {
+    _instances.clear();
+    _framedPage = nullptr;
+    unsigned int textureArray = 0;
+    for (auto page : _pages) {
+        if (page->isCollected())
+            continue;
+
+        _instances.push_back({ page->transform(), static_cast<float>(page->layer().layer) });
+        textureArray = page->layer().array;
+        if (page->isFramed())
+            _framedPage = page;
+    }
+    if (_instances.empty())
         return;
 
-    lightUtils.initLightShader(_shader, camera);
-    _shader->use();
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
+    // Le pagine scrivono lo stencil per il contorno, vanno disegnate dopo la geometria opaca
+    DrawPacket packet;
+    packet.pass = ERenderPass::stencil;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.textureArray = textureArray;
+    packet.VAO = _VAO;
+    packet.usesLights = true;
+    queue.submit(packet);
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+void PageBatch::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    GLStateCache& stateCache = GLStateCache::getInstance();
 
-    _shader->setMat4("model", _transform);
+    // Il buffer cambia solo quando una pagina viene raccolta
+    size_t bytes = _instances.size() * sizeof(PageInstance);
+    if (_instances.size() != _uploadedInstances.size() || memcmp(_instances.data(), _uploadedInstances.data(), bytes) != 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, _instances.data());
+        _uploadedInstances = _instances;
+    }
 
-    if (_framed) {
-        glEnable(GL_STENCIL_TEST);
+    // Con una pagina inquadrata lo stencil viene scritto da tutte le pagine dell'istanza:
+    // il contorno puo' essere coperto solo dove un'altra pagina si sovrappone
+    if (_framedPage != nullptr) {
+        stateCache.enable(GL_STENCIL_TEST);
         glStencilFunc(GL_ALWAYS, 1, 0xFF);
         glStencilMask(0xFF);
     }
 
-    glBindVertexArray(_VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(_instances.size()));
 
-    if (_framed) {
+    if (_framedPage != nullptr) {
         glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
         glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
         glStencilMask(0x00);
-        glDisable(GL_DEPTH_TEST);
-        _shaderSingleColor->use();
-        _shaderSingleColor->setMat4("view", camera.GetViewMatrix());
-        _shaderSingleColor->setMat4("projection", camera.GetProjection());
-        _shaderSingleColor->setMat4("model", _singleColorTransform);
-        glBindVertexArray(_VAO);
+        stateCache.disable(GL_DEPTH_TEST);
+        stateCache.useProgram(_shaderSingleColor->ID);
+        _shaderSingleColor->setMat4("model", _framedPage->singleColorTransform());
         glDrawArrays(GL_TRIANGLES, 0, 6);
 
         glStencilMask(0xFF);
         glStencilFunc(GL_ALWAYS, 0, 0xFF);
 
-        glEnable(GL_DEPTH_TEST);
-        glDisable(GL_STENCIL_TEST);
+        stateCache.disable(GL_STENCIL_TEST);
     }
 
-    glEnable(GL_DEPTH_TEST);
-
-    if (_framed)
-        RenderText("Click left mouse button to collect the page", (SCR_WIDTH / 2) - 275.0f, 200.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
-}
\ No newline at end of file
+    stateCache.enable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// matrice model per istanza, occupa le location da 3 a 6
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in float aInstanceLayer;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+flat out float Layer;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 frustumPlanes[6];
+    vec4 cameraPosition;
+};
+
+void main()
+{
+    FragPos = vec3(aInstanceModel * vec4(aPos, 1.0));
+    // Le pagine sono quad da 6 vertici: l'inversa per vertice costa meno di un attributo in piu' per istanza
+    Normal = transpose(inverse(mat3(aInstanceModel))) * aNormal;
+    TexCoords = aTexCoords;
+    Layer = aInstanceLayer;
+
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
\ No newline at end of file
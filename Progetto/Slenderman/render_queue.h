@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "gl_state_cache.h"
+#include "light_utils.h"
+#include "renderable.h"
+#include "shader_m.h"
+#include "texture_cache.h"
+#include "texture_streamer.h"
+
+// L'ordine dei pass e' l'ordine di esecuzione
+enum class ERenderPass {
+    opaque = 0,
+    stencil = 1,
+    debug = 2,
+    overlay = 3
+};
+
+struct DrawPacket {
+    ERenderPass pass = ERenderPass::opaque;
+    Renderable* owner = nullptr;
+    Shader* shader = nullptr;
+    unsigned int texture = 0;   // texture sull'unita' 0, 0 se non serve
+    unsigned int textureArray = 0;  // GL_TEXTURE_2D_ARRAY sull'unita' TEXTURE_ARRAY_UNIT, 0 se non serve
+    unsigned int VAO = 0;
+    bool usesLights = false;    // luci caricate una volta per programma
+    float distance = 0.0f;      // distanza dalla camera, decide i mip richiesti allo streamer
+    int userData = 0;
+
+    uint64_t key = 0;
+};
+
+class RenderQueue {
+private:
+    std::vector<DrawPacket> _packets;
+    // Programmi con le luci gia' caricate nel flush
+    std::vector<unsigned int> _litPrograms;
+    unsigned int _sequence = 0;
+
+    static uint64_t _makeKey(const DrawPacket& packet, const unsigned int sequence);
+
+    void _prepareProgram(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils);
+
+public:
+    void submit(DrawPacket packet);
+
+    // Ordina i pacchetti e disegna quelli dei pass fino a lastPass compreso, gli altri restano in coda
+    void flush(const Camera& camera, const LightUtils& lightUtils, const ERenderPass lastPass = ERenderPass::overlay);
+
+    inline size_t size() const { return _packets.size(); }
+};
+
+uint64_t RenderQueue::_makeKey(const DrawPacket& packet, const unsigned int sequence) {
+    uint64_t key = static_cast<uint64_t>(packet.pass) << 60;
+
+    // Nell'overlay conta l'ordine di inserimento (blending), quindi non si ordina per stato
+    if (packet.pass == ERenderPass::overlay)
+        return key | sequence;
+
+    uint64_t program = packet.shader != nullptr ? packet.shader->ID : 0;
+    key |= (program & 0xFFF) << 48;
+    uint64_t texture = packet.texture != 0 ? packet.texture : packet.textureArray;
+    key |= (texture & 0xFFFF) << 32;
+    key |= (static_cast<uint64_t>(packet.VAO) & 0xFFFF) << 16;
+    return key;
+}
+
+void RenderQueue::submit(DrawPacket packet) {
+    if (packet.texture != 0)
+        TextureStreamer::getInstance().touch(packet.texture, packet.distance);
+    packet.key = _makeKey(packet, _sequence++);
+    _packets.push_back(packet);
+}
+
+void RenderQueue::_prepareProgram(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    unsigned int program = packet.shader->ID;
+
+    // View e projection arrivano dall'uniform buffer FrameConstants, qui restano solo le luci
+    if (packet.usesLights && std::find(_litPrograms.begin(), _litPrograms.end(), program) == _litPrograms.end()) {
+        _litPrograms.push_back(program);
+        lightUtils.uploadLights(packet.shader, camera);
+    }
+}
+
+void RenderQueue::flush(const Camera& camera, const LightUtils& lightUtils, const ERenderPass lastPass) {
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    stateCache.invalidate();
+
+    // A parita' di chiave resta l'ordine di inserimento
+    std::stable_sort(_packets.begin(), _packets.end(), [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+
+    auto end = _packets.begin();
+    for (; end != _packets.end() && end->pass <= lastPass; ++end) {
+        const DrawPacket& packet = *end;
+        if (packet.shader != nullptr) {
+            stateCache.useProgram(packet.shader->ID);
+            _prepareProgram(packet, camera, lightUtils);
+        }
+        if (packet.texture != 0)
+            stateCache.bindTexture(0, packet.texture);
+        if (packet.textureArray != 0)
+            stateCache.bindTextureArray(TEXTURE_ARRAY_UNIT, packet.textureArray);
+        if (packet.VAO != 0)
+            stateCache.bindVertexArray(packet.VAO);
+
+        packet.owner->draw(packet, camera, lightUtils);
+    }
+
+    // Ripristina lo stato atteso dal codice che disegna fuori dalla coda
+    stateCache.bindVertexArray(0);
+    stateCache.activeTexture(0);
+    stateCache.enable(GL_DEPTH_TEST);
+    stateCache.disable(GL_BLEND);
+    stateCache.disable(GL_STENCIL_TEST);
+    stateCache.invalidate();
+
+    _packets.erase(_packets.begin(), end);
+    _litPrograms.clear();
+
+    // Il frame si chiude con l'ultimo flush, quando la coda e' vuota
+    if (_packets.empty()) {
+        stateCache.endFrame();
+        _sequence = 0;
+    }
+}
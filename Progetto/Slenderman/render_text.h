@@ -1,7 +1,11 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
-#include <map>
+#include <iterator>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -13,173 +17,298 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include "gl_resource.h"
 #include "shader_m.h"
+#include "streaming_buffer.h"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 void RenderText(std::string text, float x, float y, float scale, glm::vec3 color);
 
+const char* FONT_PATH = "resources/fonts/Courier-Prime-Code.ttf";
+// Atlas e metriche gia' rasterizzati: se presente e valido FreeType non viene inizializzato
+const char* FONT_ATLAS_CACHE_PATH = "resources/fonts/Courier-Prime-Code.atlas";
+const uint32_t FONT_ATLAS_MAGIC = 0x41544653; // "SFTA"
+const uint32_t FONT_ATLAS_VERSION = 2;
+const unsigned int FONT_PIXEL_SIZE = 48;
+const unsigned int FONT_GLYPHS = 128;
+const unsigned int FONT_ATLAS_WIDTH = 1024;
+const unsigned int FONT_ATLAS_PADDING = 1;
+
 /// Holds all state information relevant to a character as loaded using FreeType
 struct Character {
-  unsigned int TextureID; // ID handle of the glyph texture
   glm::ivec2   Size;      // Size of glyph
   glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
   unsigned int Advance;   // Horizontal offset to advance to next glyph
+  glm::ivec2   Offset;    // Position of the glyph inside the atlas
 };
 
-std::map<GLchar, Character> Characters;
-unsigned int VAO, VBO;
-Shader* shader;
+// Intestazione del file di cache dell'atlas, seguita da FONT_GLYPHS Character e dai pixel dell'atlas
+struct FontAtlasHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t pixelSize;
+  uint32_t glyphs;
+  uint32_t width;
+  uint32_t height;
+  uint32_t fontSize;  // Identita' del file del font da cui e' stato rasterizzato l'atlas
+  uint32_t fontHash;
+};
 
-int initRenderText(const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT)
+Character Characters[FONT_GLYPHS];
+GLTexture AtlasTexture;
+glm::ivec2 AtlasSize;
+GLVertexArray VAO;
+std::vector<float> TextVertices;
+Shader* shader = nullptr;
+
+// Dimensione e hash FNV-1a del file del font: se il font cambia su disco la cache viene rigenerata
+bool fontFileIdentity(uint32_t& size, uint32_t& hash)
 {
+  std::ifstream file(FONT_PATH, std::ios::binary);
+  if (!file)
+    return false;
 
-  // compile and setup the shader
-  // ----------------------------
-  shader = new Shader("text.vs", "text.fs");
-  glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
-  shader->use();
-  glUniformMatrix4fv(glGetUniformLocation(shader->ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  size = static_cast<uint32_t>(bytes.size());
+  hash = 2166136261u;
+  for (char byte : bytes) {
+    hash ^= static_cast<unsigned char>(byte);
+    hash *= 16777619u;
+  }
+  return true;
+}
+
+// Legge atlas e metriche dalla cache su disco, false se manca o non corrisponde al font attuale
+bool loadFontAtlasCache(std::vector<unsigned char>& pixels)
+{
+  std::ifstream file(FONT_ATLAS_CACHE_PATH, std::ios::binary);
+  if (!file)
+    return false;
+
+  uint32_t fontSize, fontHash;
+  if (!fontFileIdentity(fontSize, fontHash))
+    return false;
+
+  FontAtlasHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || header.magic != FONT_ATLAS_MAGIC || header.version != FONT_ATLAS_VERSION
+    || header.pixelSize != FONT_PIXEL_SIZE || header.glyphs != FONT_GLYPHS || header.width != FONT_ATLAS_WIDTH
+    || header.fontSize != fontSize || header.fontHash != fontHash)
+    return false;
+  // Un'altezza fuori scala indica un file corrotto: evita di allocare prima di accorgersene
+  if (header.height == 0 || header.height > FONT_ATLAS_WIDTH)
+    return false;
+
+  file.read(reinterpret_cast<char*>(Characters), sizeof(Characters));
+  pixels.resize(static_cast<size_t>(header.width) * header.height);
+  file.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+  if (!file)
+    return false;
+
+  AtlasSize = glm::ivec2(header.width, header.height);
+  return true;
+}
+
+void saveFontAtlasCache(const std::vector<unsigned char>& pixels)
+{
+  std::ofstream file(FONT_ATLAS_CACHE_PATH, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    std::cout << "WARNING::FONT: Could not write atlas cache " << FONT_ATLAS_CACHE_PATH << std::endl;
+    return;
+  }
+
+  FontAtlasHeader header = { FONT_ATLAS_MAGIC, FONT_ATLAS_VERSION, FONT_PIXEL_SIZE, FONT_GLYPHS,
+    static_cast<uint32_t>(AtlasSize.x), static_cast<uint32_t>(AtlasSize.y), 0, 0 };
+  if (!fontFileIdentity(header.fontSize, header.fontHash))
+    return;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(Characters), sizeof(Characters));
+  file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+}
 
-  // FreeType
-  // --------
+// Rasterizza i primi 128 caratteri ASCII in un unico atlas a righe
+bool rasterizeFontAtlas(std::vector<unsigned char>& pixels)
+{
   FT_Library ft;
   // All functions return a value different than 0 whenever an error occurred
   if (FT_Init_FreeType(&ft))
   {
     std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-    return -1;
-  }
-
-  // find path to font
-  //std::string font_name = "resources/fonts/Antonio-Bold.ttf";
-  std::string font_name = "resources/fonts/Courier-Prime-Code.ttf";
-  if (font_name.empty())
-  {
-    std::cout << "ERROR::FREETYPE: Failed to load font_name" << std::endl;
-    return -1;
+    return false;
   }
 
   // load font as face
   FT_Face face;
-  if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
+  if (FT_New_Face(ft, FONT_PATH, 0, &face)) {
     std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-    return -1;
+    FT_Done_FreeType(ft);
+    return false;
   }
-  else {
-    // set size to load glyphs as
-    FT_Set_Pixel_Sizes(face, 0, 48);
 
-    // disable byte-alignment restriction
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  // set size to load glyphs as
+  FT_Set_Pixel_Sizes(face, 0, FONT_PIXEL_SIZE);
 
-    // load first 128 characters of ASCII set
-    for (unsigned char c = 0; c < 128; c++)
+  // Primo passaggio: posizione dei glifi nell'atlas
+  int x = 0, y = 0, rowHeight = 0;
+  for (unsigned int c = 0; c < FONT_GLYPHS; c++)
+  {
+    Characters[c] = Character();
+    if (FT_Load_Char(face, c, FT_LOAD_RENDER))
     {
-      // Load character glyph 
-      if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-      {
-        std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-        continue;
-      }
-      // generate texture
-      unsigned int texture;
-      glGenTextures(1, &texture);
-      glBindTexture(GL_TEXTURE_2D, texture);
-      glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RED,
-        face->glyph->bitmap.width,
-        face->glyph->bitmap.rows,
-        0,
-        GL_RED,
-        GL_UNSIGNED_BYTE,
-        face->glyph->bitmap.buffer
-      );
-      // set texture options
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      // now store character for later use
-      Character character = {
-          texture,
-          glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-          glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-          static_cast<unsigned int>(face->glyph->advance.x)
-      };
-      Characters.insert(std::pair<char, Character>(c, character));
+      std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+      continue;
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    int width = face->glyph->bitmap.width;
+    int rows = face->glyph->bitmap.rows;
+    if (x + width + FONT_ATLAS_PADDING > FONT_ATLAS_WIDTH) {
+      x = 0;
+      y += rowHeight + FONT_ATLAS_PADDING;
+      rowHeight = 0;
+    }
+    Characters[c] = {
+        glm::ivec2(width, rows),
+        glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
+        static_cast<unsigned int>(face->glyph->advance.x),
+        glm::ivec2(x, y)
+    };
+    x += width + FONT_ATLAS_PADDING;
+    rowHeight = std::max(rowHeight, rows);
   }
+  AtlasSize = glm::ivec2(FONT_ATLAS_WIDTH, y + rowHeight);
+
+  // Secondo passaggio: copia delle bitmap
+  pixels.assign(static_cast<size_t>(AtlasSize.x) * AtlasSize.y, 0);
+  for (unsigned int c = 0; c < FONT_GLYPHS; c++)
+  {
+    const Character& ch = Characters[c];
+    if (ch.Size.x == 0 || FT_Load_Char(face, c, FT_LOAD_RENDER))
+      continue;
+    const FT_Bitmap& bitmap = face->glyph->bitmap;
+    for (int row = 0; row < ch.Size.y; row++)
+      std::copy(bitmap.buffer + row * bitmap.pitch, bitmap.buffer + row * bitmap.pitch + ch.Size.x,
+        pixels.begin() + static_cast<size_t>(ch.Offset.y + row) * AtlasSize.x + ch.Offset.x);
+  }
+
   // destroy FreeType once we're finished
   FT_Done_Face(face);
   FT_Done_FreeType(ft);
+  return true;
+}
 
+// Inizializza shader, atlas e buffer una sola volta per processo, le chiamate successive aggiornano solo la proiezione
+int initRenderText(const unsigned int SCR_WIDTH, const unsigned int SCR_HEIGHT)
+{
+  if (shader == nullptr) {
+    // compile and setup the shader
+    // ----------------------------
+    shader = new Shader("text.vs", "text.fs");
 
-  // configure VAO/VBO for texture quads
-  // -----------------------------------
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+    std::vector<unsigned char> pixels;
+    if (!loadFontAtlasCache(pixels)) {
+      if (!rasterizeFontAtlas(pixels))
+        return -1;
+      saveFontAtlasCache(pixels);
+    }
+
+    // disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    AtlasTexture = GLTexture::create();
+    glBindTexture(GL_TEXTURE_2D, AtlasTexture.id());
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, AtlasSize.x, AtlasSize.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    AtlasTexture.setBytes(GLResourceRegistry::textureBytes(AtlasSize.x, AtlasSize.y, 1));
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // configure VAO for texture quads, the vertices of each line are written to the streaming buffer
+    // ------------------------------------------------------------------------------------------------
+    VAO = GLVertexArray::create();
+    glBindVertexArray(VAO.id());
+    glBindBuffer(GL_ARRAY_BUFFER, StreamingBuffer::getInstance().buffer());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+  }
+
+  glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
+  shader->use();
+  glUniformMatrix4fv(glGetUniformLocation(shader->ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+  return 0;
 }
-    
+
+void destroyRenderText()
+{
+  if (shader == nullptr)
+    return;
+
+  AtlasTexture.reset();
+  VAO.reset();
+  delete shader;
+  shader = nullptr;
+}
+
 
 // render line of text
 // -------------------
 void RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
 {
-  // activate corresponding render state	
-  shader->use();
-  glUniform3f(glGetUniformLocation(shader->ID, "textColor"), color.x, color.y, color.z);
-  glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(VAO);
-
-  glEnable(GL_CULL_FACE);
-  glCullFace(GL_BACK);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  // iterate through all characters
-  std::string::const_iterator c;
-  for (c = text.begin(); c != text.end(); c++)
+  // Tutti i glifi stanno nello stesso atlas: la riga intera e' un solo draw
+  TextVertices.clear();
+  glm::vec2 texel = 1.0f / glm::vec2(AtlasSize);
+  for (std::string::const_iterator c = text.begin(); c != text.end(); c++)
   {
-    Character ch = Characters[*c];
+    const Character& ch = Characters[static_cast<unsigned char>(*c) % FONT_GLYPHS];
 
     float xpos = x + ch.Bearing.x * scale;
     float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
 
     float w = ch.Size.x * scale;
     float h = ch.Size.y * scale;
-    // update VBO for each character
+
+    glm::vec2 uvMin = glm::vec2(ch.Offset) * texel;
+    glm::vec2 uvMax = glm::vec2(ch.Offset + ch.Size) * texel;
+
     float vertices[6][4] = {
-        { xpos,     ypos + h,   0.0f, 0.0f },
-        { xpos,     ypos,       0.0f, 1.0f },
-        { xpos + w, ypos,       1.0f, 1.0f },
+        { xpos,     ypos + h,   uvMin.x, uvMin.y },
+        { xpos,     ypos,       uvMin.x, uvMax.y },
+        { xpos + w, ypos,       uvMax.x, uvMax.y },
 
-        { xpos,     ypos + h,   0.0f, 0.0f },
-        { xpos + w, ypos,       1.0f, 1.0f },
-        { xpos + w, ypos + h,   1.0f, 0.0f }
+        { xpos,     ypos + h,   uvMin.x, uvMin.y },
+        { xpos + w, ypos,       uvMax.x, uvMax.y },
+        { xpos + w, ypos + h,   uvMax.x, uvMin.y }
     };
-    // render glyph texture over quad
-    glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-    // update content of VBO memory
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
+    TextVertices.insert(TextVertices.end(), &vertices[0][0], &vertices[0][0] + 24);
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    // render quad
-    glDrawArrays(GL_TRIANGLES, 0, 6);
     // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
     x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
   }
+  if (TextVertices.empty())
+    return;
+
+  // activate corresponding render state
+  shader->use();
+  glUniform3f(glGetUniformLocation(shader->ID, "textColor"), color.x, color.y, color.z);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, AtlasTexture.id());
+  glBindVertexArray(VAO.id());
+
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_BACK);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  // the line is appended to the streaming buffer: the first vertex of the draw is its offset in vertices
+  const size_t stride = 4 * sizeof(float);
+  size_t offset = StreamingBuffer::getInstance().upload(TextVertices.data(), sizeof(float) * TextVertices.size(), stride);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glDrawArrays(GL_TRIANGLES, static_cast<GLint>(offset / stride), static_cast<GLsizei>(TextVertices.size() / 4));
+
   glBindVertexArray(0);
   glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -1,41 +1,82 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
 
 #include <glm/glm.hpp>
 
 #include "camera.h"
+#include "gl_resource.h"
+#include "gl_state_cache.h"
+#include "instance_data.h"
 #include "light_utils.h"
+#include "map_random.h"
+#include "memory_stats.h"
 #include "model.h";
+#include "occlusion_culler.h"
 #include "shader_m.h";
+#include "static_geometry.h"
+#include "texture_streamer.h"
+#include "thread_pool.h"
 
-class Renderable {
+class RenderQueue;
+struct DrawPacket;
+
+class Renderable : public MemoryReporter {
 protected:
     Shader* _shader;
     unsigned int _texture;
 
+    static void _bindMeshTextures(const Shader& shader, const Mesh& mesh, const float distance = 0.0f);
+
+    // Matrice delle normali calcolata una volta sulla CPU invece che per vertice nello shader
+    static inline glm::mat3 _normalMatrixOf(const glm::mat4& transform) { return glm::transpose(glm::inverse(glm::mat3(transform))); }
+
 public:
     virtual ~Renderable() {}
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) = 0;
+    // Inserisce nella coda i pacchetti di disegno del frame
+    virtual void submit(RenderQueue& queue, const Camera& camera) {}
+
+    // Disegna un pacchetto: programma, texture e VAO del pacchetto sono gia' bindati dalla coda
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {}
+
+    // Disegno immediato, fuori dalla coda
+    virtual void render(const Camera& camera, const LightUtils& lightUtils) {}
+
+    // Memoria propria della renderable: modelli, shader e texture condivisi sono contati dalle cache
+    virtual MemoryUsage memoryUsage() const override { return MemoryUsage(); }
 };
 
 class VAORenderable : public Renderable {
 protected:
     unsigned int _VAO;
     glm::mat4 _transform;
+    glm::mat3 _normalMatrix = glm::mat3(1.0f);
+    // Oggetti GL creati dalla renderable, cancellati con lei
+    GLResources _glResources;
 
-    static unsigned int _initRectVAO(const float dimension);
+    unsigned int _initRectVAO(const float dimension);
 
 public:
     virtual ~VAORenderable() {}
+
+    virtual MemoryUsage memoryUsage() const override;
 };
 
 class ModelRenderable : public Renderable {
 protected:
     Model* _model;
     glm::mat4 _transform;
+    glm::mat3 _normalMatrix = glm::mat3(1.0f);
+
+    void _drawModel(const float distance = 0.0f) const;
+
+    // Test di occlusione del modello nella posizione corrente
+    bool _isVisible() const;
+
+    inline float _distanceFrom(const Camera& camera) const { return glm::length(camera.Position - glm::vec3(_transform[3])); }
 
 public:
     inline const Model* model() const { return _model; }
@@ -46,14 +87,25 @@ public:
 class InstancedModelRenderable : public Renderable {
 protected:
     Model* _model;
-    std::vector<glm::mat4> _transforms;
+    std::vector<InstanceData> _instances;
+    glm::vec3 _scaleAxes = glm::vec3(1.0f);
+    // Buffer di istanze e VAO per chunk: i VAO sono registrati nelle mesh del modello condiviso ma appartengono alla renderable
+    GLResources _glResources;
 
-    void _initUsingDynamicMapAlgorithm(const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scaleMatrix, const bool useRandomOffset, const std::unordered_set<int>& tabooIndices = { });
+    void _initUsingDynamicMapAlgorithm(const uint32_t seed, const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scaleMatrix, const bool useRandomOffset, const std::unordered_set<int>& tabooIndices = { });
 
 public:
+    inline const Model* model() const { return _model; }
+
+    inline const std::vector<InstanceData>& instances() const { return _instances; }
+
+    inline const glm::vec3& scaleAxes() const { return _scaleAxes; }
+
+    virtual MemoryUsage memoryUsage() const override;
+
     virtual ~InstancedModelRenderable() {
-        _transforms.clear();
-        _transforms.shrink_to_fit();
+        _instances.clear();
+        _instances.shrink_to_fit();
 
         for (unsigned int i = 0; i < _model->meshes.size(); i++) {
             _model->meshes[i].VAOs.clear();
@@ -62,6 +114,56 @@ public:
     }
 };
 
+void Renderable::_bindMeshTextures(const Shader& shader, const Mesh& mesh, const float distance) {
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    unsigned int normalNr = 1;
+    unsigned int heightNr = 1;
+    for (unsigned int i = 0; i < mesh.textures.size(); i++) {
+        std::string number;
+        const std::string& name = mesh.textures[i].type;
+        if (name == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if (name == "texture_specular")
+            number = std::to_string(specularNr++);
+        else if (name == "texture_normal")
+            number = std::to_string(normalNr++);
+        else if (name == "texture_height")
+            number = std::to_string(heightNr++);
+
+        glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+        GLStateCache::getInstance().bindTexture(i, mesh.textures[i].id);
+        TextureStreamer::getInstance().touch(mesh.textures[i].id, distance);
+    }
+}
+
+void ModelRenderable::_drawModel(const float distance) const {
+    StaticGeometry& staticGeometry = StaticGeometry::getInstance();
+    GLStateCache::getInstance().bindVertexArray(staticGeometry.VAO());
+    staticGeometry.draw(*_model, _texture, distance);
+}
+
+bool ModelRenderable::_isVisible() const {
+    if (!USE_OCCLUSION_CULLING)
+        return true;
+    return OcclusionCuller::getInstance().isVisible(StaticGeometry::getInstance().bounds(*_model).transformed(_transform), EOcclusionGroup::object);
+}
+
+MemoryUsage VAORenderable::memoryUsage() const {
+    MemoryUsage usage;
+    usage.gpuBytes = _glResources.bytes();
+    return usage;
+}
+
+MemoryUsage InstancedModelRenderable::memoryUsage() const {
+    MemoryUsage usage;
+    usage.cpuBytes = vectorBytes(_instances);
+    usage.gpuBytes = _glResources.bytes();
+    for (const auto& mesh : _model->meshes)
+        usage.cpuBytes += vectorBytes(mesh.VAOs);
+    return usage;
+}
+
 unsigned int VAORenderable::_initRectVAO(const float dimension) {
     float rectVertices[] = {
         // positions            // normals         // texcoords
@@ -74,11 +176,8 @@ unsigned int VAORenderable::_initRectVAO(const float dimension) {
          dimension, 0.0f, -dimension,  0.0f, 1.0f, 0.0f,  dimension, dimension
     };
 
-    unsigned int rectVAO;
-    unsigned int rectVBO;
-
-    glGenVertexArrays(1, &rectVAO);
-    glGenBuffers(1, &rectVBO);
+    unsigned int rectVAO = _glResources.vertexArray();
+    unsigned int rectVBO = _glResources.buffer(sizeof(rectVertices));
 
     glBindVertexArray(rectVAO);
 
@@ -97,78 +196,61 @@ unsigned int VAORenderable::_initRectVAO(const float dimension) {
     return rectVAO;
 }
 
-void InstancedModelRenderable::_initUsingDynamicMapAlgorithm(const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scaleMatrix, const bool useRandomOffset, const std::unordered_set<int>& tabooIndices) {
-    int numVAO = (quadSide / vaoObjectSide) * (quadSide / vaoObjectSide);
-    unsigned int amount = quadSide * quadSide;
-    std::vector<glm::mat4*> transformMatrix;
-    for (int k = 0; k < numVAO; k++)
-        transformMatrix.push_back(new glm::mat4[(amount / numVAO)]);
+void InstancedModelRenderable::_initUsingDynamicMapAlgorithm(const uint32_t seed, const int quadSide, const int vaoObjectSide, const float offset, const glm::vec3& scaleMatrix, const bool useRandomOffset, const std::unordered_set<int>& tabooIndices) {
+    int numVAOForSide = quadSide / vaoObjectSide;
+    int numVAO = numVAOForSide * numVAOForSide;
+    int instancesForVAO = vaoObjectSide * vaoObjectSide;
+    // Istanze contigue per chunk: ogni chunk e' generato da un task che scrive solo il proprio intervallo
+    std::vector<InstanceData> instanceData(static_cast<size_t>(numVAO) * instancesForVAO);
 
-    srand(glfwGetTime());
+    // La scala per istanza e' quella sull'asse x, le proporzioni degli altri assi sono comuni a tutte le istanze
+    _scaleAxes = scaleMatrix / scaleMatrix.x;
 
-    for (int i = 0; i < quadSide; i++) {
-        for (int j = 0; j < quadSide; j++) {
-            glm::mat4 transform = glm::mat4(1.0f);
+    ThreadPool::getInstance().parallelFor(numVAO, [&](int vaoIndex) {
+        int vaoI = vaoIndex / numVAOForSide;
+        int vaoJ = vaoIndex % numVAOForSide;
+
+        for (int instanceIndex = 0; instanceIndex < instancesForVAO; instanceIndex++) {
+            int i = vaoI * vaoObjectSide + instanceIndex / vaoObjectSide;
+            int j = vaoJ * vaoObjectSide + instanceIndex % vaoObjectSide;
+            // Stesso indice e stessi stream di grass_procedural.vs
+            uint32_t index = static_cast<uint32_t>(i * quadSide + j);
 
             float rx = 0.0f;
             float rz = 0.0f;
             if (useRandomOffset) {
-                rx = static_cast <float> (rand()) / static_cast <float> (RAND_MAX) * offset / 2;
-                rz = static_cast <float> (rand()) / static_cast <float> (RAND_MAX) * offset / 2;
+                rx = MapRandom::random(seed, index, 0) * offset / 2;
+                rz = MapRandom::random(seed, index, 1) * offset / 2;
             }
 
             // 1. Traslazione degli alberi in base all'indice della griglia
             float x = (i - quadSide / 2) * offset + rx;
             float y = -4.0f;
             float z = (j - quadSide / 2) * offset + rz;
-            transform = glm::translate(transform, glm::vec3(x, y, z));
-            // 2. Scala gli alberi
-            transform = glm::scale(transform, scaleMatrix);
-            // 3. Rotazione randomica
-            float rotAngle = (rand() % 360);
-            transform = glm::rotate(transform, rotAngle, glm::vec3(0.0f, 1.0f, 0.0f));
-
-            // 4. Aggiunge al matrice al modello
-            unsigned int vaoI = floor(i / vaoObjectSide);
-            unsigned int vaoJ = floor(j / vaoObjectSide);
-            unsigned int vaoIndex = (vaoI * (quadSide / vaoObjectSide)) + vaoJ;
-
-            unsigned int matrixIndex = ((i % vaoObjectSide) * vaoObjectSide) + (j % vaoObjectSide);
-            if (tabooIndices.find(vaoIndex) == tabooIndices.end()) {
-                _transforms.push_back(transform);
-            }
+            // 2. Rotazione randomica
+            float rotAngle = MapRandom::random(seed, index, 2) * 2.0f * glm::pi<float>();
 
-            transformMatrix[vaoIndex][matrixIndex] = transform;
+            // 3. Aggiunge l'istanza al chunk
+            instanceData[static_cast<size_t>(vaoIndex) * instancesForVAO + instanceIndex] = InstanceData::make(glm::vec3(x, y, z), rotAngle, scaleMatrix.x);
         }
-    }
+    });
 
     for (int k = 0; k < numVAO; k++) {
-        glm::mat4* transform = transformMatrix[k];
+        if (tabooIndices.find(k) == tabooIndices.end())
+            _instances.insert(_instances.end(), instanceData.begin() + static_cast<size_t>(k) * instancesForVAO, instanceData.begin() + static_cast<size_t>(k + 1) * instancesForVAO);
+    }
 
-        unsigned int buffer;
-        glGenBuffers(1, &buffer);
+    for (int k = 0; k < numVAO; k++) {
+        unsigned int buffer = _glResources.buffer(instancesForVAO * sizeof(InstanceData));
         glBindBuffer(GL_ARRAY_BUFFER, buffer);
 
-        glBufferData(GL_ARRAY_BUFFER, (amount / numVAO) * sizeof(glm::mat4), transform, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, instancesForVAO * sizeof(InstanceData), &instanceData[static_cast<size_t>(k) * instancesForVAO], GL_STATIC_DRAW);
 
         for (unsigned int i = 0; i < _model->meshes.size(); i++) {
-            unsigned int VAO;
-            glGenVertexArrays(1, &VAO);
+            unsigned int VAO = _glResources.vertexArray();
             glBindVertexArray(VAO);
 
-            glEnableVertexAttribArray(3);
-            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-            glEnableVertexAttribArray(4);
-            glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-            glEnableVertexAttribArray(5);
-            glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-            glEnableVertexAttribArray(6);
-            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-            glVertexAttribDivisor(3, 1);
-            glVertexAttribDivisor(4, 1);
-            glVertexAttribDivisor(5, 1);
-            glVertexAttribDivisor(6, 1);
+            InstanceData::setupAttributes();
 
             glEnableVertexAttribArray(0);
 
@@ -180,10 +262,4 @@ void InstancedModelRenderable::_initUsingDynamicMapAlgorithm(const int quadSide,
     for (unsigned int i = 0; i < _model->meshes.size(); i++) {
         _model->meshes[i].setupVAOs();
     }
-
-    for (auto&& matrix : transformMatrix)
-        delete[] matrix;
-
-    transformMatrix.clear();
-    transformMatrix.shrink_to_fit();
 }
\ No newline at end of file
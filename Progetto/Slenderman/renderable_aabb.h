@@ -1,79 +1,96 @@
 #pragma once
 
+#include <algorithm>
+
 #include "aabb.h"
 #include "constants.h"
+#include "game_state.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
+#include "streaming_buffer.h"
 
+// Gli spigoli vengono scritti nel buffer di streaming a ogni draw: nessun buffer per AABB e il box disegnato
+// e' sempre quello corrente. Visibilita' e colore vengono dall'ultimo snapshot letto dalla scena sul thread principale
 class RenderableAABB : public VAORenderable {
 private:
-    aabb* _staticAABB;
+    const aabb* _staticAABB;
+    const GameSnapshot& _snapshot;
+    glm::vec3 _lines[24];
+
+    void _updateLines();
+
+    static bool _contains(const std::vector<const aabb*>& aabbs, const aabb* staticAABB);
 
 public:
-    RenderableAABB(aabb* staticAABB);
+    RenderableAABB(const aabb* staticAABB, const GameSnapshot& snapshot);
+
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
-RenderableAABB::RenderableAABB(aabb* staticAABB) : _staticAABB(staticAABB) {
+RenderableAABB::RenderableAABB(const aabb* staticAABB, const GameSnapshot& snapshot) : _staticAABB(staticAABB), _snapshot(snapshot) {
     _shader = ShaderCache::getInstance().findShader(EShader::aabb);
 
-    float vertices[] = {
-        _staticAABB->getMin().x, _staticAABB->getMin().y, _staticAABB->getMin().z,
-        _staticAABB->getMax().x, _staticAABB->getMin().y, _staticAABB->getMin().z,
-        _staticAABB->getMax().x, _staticAABB->getMax().y, _staticAABB->getMin().z,
-        _staticAABB->getMin().x, _staticAABB->getMax().y, _staticAABB->getMin().z,
-        _staticAABB->getMin().x, _staticAABB->getMin().y, _staticAABB->getMax().z,
-        _staticAABB->getMax().x, _staticAABB->getMin().y, _staticAABB->getMax().z,
-        _staticAABB->getMax().x, _staticAABB->getMax().y, _staticAABB->getMax().z,
-        _staticAABB->getMin().x, _staticAABB->getMax().y, _staticAABB->getMax().z,
+    _VAO = _glResources.vertexArray();
+    glBindVertexArray(_VAO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, StreamingBuffer::getInstance().buffer());
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+bool RenderableAABB::_contains(const std::vector<const aabb*>& aabbs, const aabb* staticAABB) {
+    return std::find(aabbs.begin(), aabbs.end(), staticAABB) != aabbs.end();
+}
+
+void RenderableAABB::_updateLines() {
+    glm::vec3 min = _staticAABB->getMin();
+    glm::vec3 max = _staticAABB->getMax();
+    glm::vec3 corners[] = {
+        glm::vec3(min.x, min.y, min.z),
+        glm::vec3(max.x, min.y, min.z),
+        glm::vec3(max.x, max.y, min.z),
+        glm::vec3(min.x, max.y, min.z),
+        glm::vec3(min.x, min.y, max.z),
+        glm::vec3(max.x, min.y, max.z),
+        glm::vec3(max.x, max.y, max.z),
+        glm::vec3(min.x, max.y, max.z),
     };
 
-    unsigned int indices[] = {
+    const unsigned int indices[] = {
         0, 1, 1, 2, 2, 3, 3, 0,
         4, 5, 5, 6, 6, 7, 7, 4,
         0, 4, 1, 5, 2, 6, 3, 7
     };
 
-    unsigned int VBO, VAO, EBO;
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    _VAO = VAO;
+    for (int i = 0; i < 24; i++)
+        _lines[i] = corners[indices[i]];
 }
 
-void RenderableAABB::render(const Camera& camera, const LightUtils& lightUtils) {
-    if (!_staticAABB->shouldBeRendered())
+void RenderableAABB::submit(RenderQueue& queue, const Camera& camera) {
+    if (!_contains(_snapshot.testedAABBs, _staticAABB))
         return;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glEnable(GL_DEPTH_TEST);
+    DrawPacket packet;
+    packet.pass = ERenderPass::debug;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.VAO = _VAO;
+    queue.submit(packet);
+}
 
-    _shader->use();
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
-    _shader->setVec4("color", _staticAABB->hasIntersection() ? RED : AABB_COLOR);
+void RenderableAABB::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
+    GLStateCache::getInstance().enable(GL_DEPTH_TEST);
 
-    glBindVertexArray(_VAO);
-    glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, 0);
-
-    glBindVertexArray(0);
+    _updateLines();
+    size_t offset = StreamingBuffer::getInstance().upload(_lines, sizeof(_lines), sizeof(glm::vec3));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    _staticAABB->disableRendering();
+    _shader->setVec4("color", _contains(_snapshot.intersectedAABBs, _staticAABB) ? RED : AABB_COLOR);
+    glDrawArrays(GL_LINES, static_cast<GLint>(offset / sizeof(glm::vec3)), 24);
 }
@@ -3,42 +3,57 @@
 #include "aabb.h"
 #include "light_utils.h"
 #include "model_cache.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
 
 class RenderablePOI : public ModelRenderable {
+private:
+    // Layer della texture nell'array dei POI: tutti i POI condividono lo stesso bind
+    TextureLayer _layer;
+
 public:
     RenderablePOI(ETexture texture, EModel model, glm::mat4 transform);
 
     inline aabb* toAABB() const;
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
 RenderablePOI::RenderablePOI(ETexture texture, EModel model, glm::mat4 transform) {
     _shader = ShaderCache::getInstance().findShader(EShader::poi);
     _model = ModelCache::getInstance().findModel(model);
-    _texture = TextureCache::getInstance().findTexture(texture);
+    _texture = 0;
+    _layer = TextureCache::getInstance().findLayer(texture);
 
     _transform = transform;
+    _normalMatrix = _normalMatrixOf(_transform);
 }
 
 aabb* RenderablePOI::toAABB() const {
     return aabb::fromModel(*(_model), _transform);
 }
 
-void RenderablePOI::render(const Camera& camera, const LightUtils& lightUtils) {
-    lightUtils.initLightShader(_shader, camera);
-
-    _shader->use();
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+void RenderablePOI::submit(RenderQueue& queue, const Camera& camera) {
+    if (!_isVisible())
+        return;
+
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.textureArray = _layer.array;
+    packet.VAO = StaticGeometry::getInstance().VAO();
+    packet.usesLights = true;
+    packet.distance = _distanceFrom(camera);
+    queue.submit(packet);
+}
 
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
+void RenderablePOI::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
     _shader->setMat4("model", _transform);
-
-    _model->Draw(*_shader);
-}
\ No newline at end of file
+    _shader->setMat3("normalMatrix", _normalMatrix);
+    StaticGeometry::getInstance().drawLayered(*_model, *_shader, _layer, packet.distance);
+}
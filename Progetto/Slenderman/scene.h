@@ -3,6 +3,7 @@
 #include <map>
 
 #include "camera.h"
+#include "frame_clock.h"
 #include "input_manager.h"
 
 enum class EScene {
@@ -19,7 +20,7 @@ protected:
 public:
     virtual void init() = 0;
 
-    virtual void process(const float& deltaTime) = 0;
+    virtual void process(const FrameClock& clock) = 0;
 
     virtual void destroy() = 0;
 
@@ -29,7 +30,7 @@ public:
 class NullScene : public Scene {
     virtual void init() { };
 
-    virtual void process(const float& deltaTime) override { };
+    virtual void process(const FrameClock& clock) override { };
 
     virtual void destroy() override { };
 
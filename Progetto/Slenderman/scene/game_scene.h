@@ -13,36 +13,55 @@
 #include "../collision_solver.h"
 #include "../constants.h"
 #include "../dynamic_map_renderable.h"
+#include "../dynamic_resolution.h"
 #include "../fear_renderable.h"
 #include "../fence.h"
 #include "../floor.h"
+#include "../frame_constants.h"
+#include "../gl_resource.h"
 #include "../fullscreen_image.h"
+#include "../game_simulation.h"
+#include "../game_state.h"
+#include "../impostor_renderable.h"
 #include "../input_manager.h"
+#include "../input_recorder.h"
 #include "../light_utils.h"
 #include "../map_initializer.h"
+#include "../memory_stats.h"
 #include "../minimap.h"
 #include "../model_cache.h"
+#include "../occlusion_culler.h"
+#include "../streaming_buffer.h"
 #include "../texture_cache.h"
+#include "../world_cache.h"
 #include "../renderable_aabb.h"
 #include "../renderable_poi.h"
+#include "../render_queue.h"
 #include "../render_text.h"
 #include "../scene.h"
 #include "../shader_cache.h"
 #include "../slenderman.h"
+#include "../static_geometry.h"
 #include "../street_light.h"
 #include "../slender_manager.h"
 #include "../model_cache.h"
 
 
-class GameScene : public Scene {
+class GameScene : public Scene, public MemoryReporter {
 private:
     SceneManager* _sceneManager;
 
     vector<Renderable*> _renderables;
+    RenderQueue _renderQueue;
+    DynamicResolution _dynamicResolution;
 
     CollisionSolver _collisionSolver;
-    double _previousTime = 0.0;
-    double _previousEscMenuTime = 0.0;
+    // Creata al primo frame, quando e' disponibile il tempo del FrameClock
+    GameSimulation* _simulation = nullptr;
+    uint32_t _mapSeed = 0;
+    GameSnapshot _previousSnapshot;
+    GameSnapshot _currentSnapshot;
+    std::vector<ESimEvent> _simEvents;
 
     Page* _pageFramed = nullptr;
     int _collectedPages = 0;
@@ -54,25 +73,26 @@ private:
     std::unordered_set<int>* _tabooIndices;
 
     SlenderMan* _slenderMan;
-    SlenderManager* _slenderManager;
-    vector<glm::vec3> _slendermanSpawnPoints;
+    SpawnPointGrid _slendermanSpawnPoints;
     float _fearFactor = 0.0f;
-    float _loseThreshold = 1.0f;
     vector<Page*> _pages;
 
     FullsceenImage* _menuIngame;
     FullsceenImage* _loseImage;
     FullsceenImage* _winImage;
-    float _timerTransition = 0.0f;
+    double _timerTransition = 0.0;
     bool _menuOpen = false;
-    bool _shouldQuit = false;
 
-    float _lastPlayedFootstep = 0.0f;
+    double _startTime = -1.0;
+    double _frameTime = 0.0;
 
-    float _startTime = -1.0f;
+    // Ultima raccolta delle statistiche di memoria mostrate nell'overlay
+    std::vector<MemoryStatsEntry> _memoryEntries;
+    double _memoryStatsTime = -1.0;
 
-    void _processInput(const float& deltaTime, const CollisionResult& collisionResult);
-    void _findFramedPage();
+    InputState _sampleInput() const;
+    void _processSimEvents();
+    void _applySnapshot(const FrameClock& clock);
 
     void _renderInfo();
 
@@ -81,27 +101,30 @@ public:
 
     virtual void init() override;
 
-    virtual void process(const float& deltaTime) override;
+    virtual void process(const FrameClock& clock) override;
 
     virtual void destroy() override;
 
     inline virtual Camera* currentCamera() override;
+
+    // Renderable e pagine della partita corrente
+    virtual MemoryUsage memoryUsage() const override;
 };
 
 
 void GameScene::init() {
-    _poiInfo = MapInitializer::initPOI();
+    // A parita' di seed la generazione e' identica con qualunque numero di thread. Il mondo usa il seed della
+    // prima partita e viene riusato, a ogni partita cambiano POI, pagine e spawn di Slenderman
+    uint32_t mapSeed = MapInitializer::mapSeed();
+    _poiInfo = MapInitializer::initPOI(mapSeed);
     _slendermanSpawnPoints = MapInitializer::initSlenderSpawnPoints(_poiInfo);
 
     _lightUtils.setLights(_poiInfo);
 
-    _renderables.push_back(new Floor());
-
-    _slenderMan = new SlenderMan();
-    _slenderManager = new SlenderManager();
-    _renderables.push_back(_slenderMan);
-
-    _renderables.push_back(new DynamicMapRenderable(DynamicEntity::grass));
+    WorldCache& world = WorldCache::getInstance();
+    world.build(mapSeed, _poiInfo);
+    // La profondita' della partita precedente non vale per la nuova camera
+    OcclusionCuller::getInstance().invalidate();
 
     unordered_set<int> tabooIndices = unordered_set<int>();
     for (int index : K_SET_TO_EXCLUDE)
@@ -110,110 +133,89 @@ void GameScene::init() {
     for (auto poi : _poiInfo)
         tabooIndices.insert(poi.first);
 
-    DynamicMapRenderable* forest = new DynamicMapRenderable(DynamicEntity::tree, tabooIndices);
-    _renderables.push_back(forest);
-    std::vector<aabb*> forestAABBs = forest->toAABBs();
-    _collisionSolver.registerAABBs(forestAABBs);
-    for (auto forestAABB : forestAABBs)
-        if (DEBUG)
-            _renderables.push_back(new RenderableAABB(forestAABB));
-
-    aabb* fenceFront = new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT, -4.0f, MAX_PLAYER_DISTANCE_FRONT + 0.25f), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT, 0.0f, MAX_PLAYER_DISTANCE_FRONT - 0.25f));
-    _collisionSolver.registerAABB(fenceFront);
-    aabb* fenceBack = new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT, -4.0f, MAX_PLAYER_DISTANCE_BACK + 0.25f), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT, 0.0f, MAX_PLAYER_DISTANCE_BACK - 0.25f));
-    _collisionSolver.registerAABB(fenceBack);
-    aabb* fenceRight = new aabb(glm::vec3(MAX_PLAYER_DISTANCE_RIGHT + 0.25, -4.0f, MAX_PLAYER_DISTANCE_BACK), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT - 0.25f, 0.0f, MAX_PLAYER_DISTANCE_FRONT));
-    _collisionSolver.registerAABB(fenceRight);
-    aabb* fenceLeft = new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT - 0.25f, -4.0f, MAX_PLAYER_DISTANCE_BACK), glm::vec3(MAX_PLAYER_DISTANCE_LEFT + 0.25f, 0.0f, MAX_PLAYER_DISTANCE_FRONT));
-    _collisionSolver.registerAABB(fenceLeft);
-
-    if (DEBUG) {
-        _renderables.push_back(new RenderableAABB(fenceFront));
-        _renderables.push_back(new RenderableAABB(fenceBack));
-        _renderables.push_back(new RenderableAABB(fenceRight));
-        _renderables.push_back(new RenderableAABB(fenceLeft));
-    }
+    std::vector<aabb*> worldAABBs = world.beginRun(tabooIndices, _poiInfo, _collisionSolver);
+    if (DEBUG)
+        for (auto worldAABB : worldAABBs)
+            _renderables.push_back(new RenderableAABB(worldAABB, _currentSnapshot));
 
+    _slenderMan = new SlenderMan();
+    _renderables.push_back(_slenderMan);
 
-    _renderables.push_back(new Fence());
+    MapInitializer::addPOIRenderablesAndStreetLights(mapSeed, _poiInfo, _pages, _renderables, _collisionSolver);
 
-    MapInitializer::addPOIRenderablesAndStreetLights(_poiInfo, _pages, _renderables, _collisionSolver);
-    _renderables.push_back(new Minimap(_poiInfo));
+    _renderables.push_back(new FearRenderable(_fearFactor, _frameTime));
 
-    _renderables.push_back(new FearRenderable(_fearFactor));
+    MemoryStats::getInstance().add("game scene", this);
+    MemoryStats::getInstance().add("collision", &_collisionSolver);
 
     _menuIngame = new FullsceenImage(ETexture::menuIngame);
     _loseImage = new FullsceenImage(ETexture::loseImage);
     _winImage = new FullsceenImage(ETexture::winImage);
+
+    _mapSeed = mapSeed;
 }
 
-void GameScene::_processInput(const float& deltaTime, const CollisionResult& collisionResult) {
-    if (_menuOpen && InputManager::isKeyPressed(GLFW_KEY_M)) {
-        AudioManager::getInstance().pauseMusic(EMusic::background);
-        _sceneManager->changeScene(EScene::menu);
-        _shouldQuit = true;
-        return;
-    }
+InputState GameScene::_sampleInput() const {
+    InputState input;
+    input.forward = InputManager::isKeyPressed(GLFW_KEY_W);
+    input.backward = InputManager::isKeyPressed(GLFW_KEY_S);
+    input.left = InputManager::isKeyPressed(GLFW_KEY_A);
+    input.right = InputManager::isKeyPressed(GLFW_KEY_D);
+    input.sprint = InputManager::isKeyPressed(GLFW_KEY_LEFT_SHIFT);
+    input.flashlight = InputManager::isKeyPressed(GLFW_KEY_F);
+    input.escape = InputManager::isKeyPressed(GLFW_KEY_ESCAPE);
+    input.quitToMenu = InputManager::isKeyPressed(GLFW_KEY_M);
+    input.collect = InputManager::isLeftMouseButtonPressed();
+    input.yaw = _camera.Yaw;
+    input.pitch = _camera.Pitch;
+    return input;
+}
 
-    if (InputManager::isKeyPressed(GLFW_KEY_ESCAPE)) {
-        double currentTime = glfwGetTime();
-        if (currentTime - _previousEscMenuTime > 0.3f) {
-            _previousEscMenuTime = currentTime;
-            _menuOpen = !_menuOpen;
-            _camera.forceBlockCamera = _menuOpen;
-
-            if (_menuOpen) {
-                AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, 0);
-                AudioManager::getInstance().setMusicVolume(EMusic::highFear, 0);
-            }
+void GameScene::_processSimEvents() {
+    _simEvents.clear();
+    _simulation->drainEvents(_simEvents);
+
+    for (auto event : _simEvents) {
+        switch (event) {
+        case ESimEvent::footstep:
+            if (!AudioManager::getInstance().isPlayingFootstep())
+                AudioManager::getInstance().playRandomFootstep();
+            break;
+        case ESimEvent::pageCollected:
+            AudioManager::getInstance().playSfx(ESfx::paper);
+            break;
         }
     }
+}
 
-    if (_menuOpen) {
-        return;
-    }
-
-    bool superSaiyan = InputManager::isKeyPressed(GLFW_KEY_LEFT_SHIFT) && DEBUG;
-    float speedIncrement = superSaiyan ? 150.0f : 0.0f;
+void GameScene::_applySnapshot(const FrameClock& clock) {
+    _simulation->readSnapshots(_previousSnapshot, _currentSnapshot);
+    const GameSnapshot& previous = _previousSnapshot;
+    const GameSnapshot& current = _currentSnapshot;
 
-    bool shouldPlayFootstep = false;
+    // Il rendering e' in ritardo di un tick: si interpola tra gli ultimi due snapshot
+    double tick = 1.0 / SIMULATION_TICK_RATE;
+    float alpha = glm::clamp(static_cast<float>((clock.time - current.time) / tick), 0.0f, 1.0f);
+    _camera.Position = glm::mix(previous.cameraPosition, current.cameraPosition, alpha);
+    _fearFactor = glm::mix(previous.fearFactor, current.fearFactor, alpha);
 
-    if (InputManager::isKeyPressed(GLFW_KEY_W) && (!collisionResult.n || superSaiyan)) {
-        shouldPlayFootstep = true;
-        _camera.ProcessKeyboard(FORWARD, deltaTime, speedIncrement);
-    }
-    if (InputManager::isKeyPressed(GLFW_KEY_S) && (!collisionResult.s || superSaiyan)) {
-        shouldPlayFootstep = true;
-        _camera.ProcessKeyboard(BACKWARD, deltaTime, speedIncrement);
-    }
-    if (InputManager::isKeyPressed(GLFW_KEY_A) && (!collisionResult.w || superSaiyan)) {
-        shouldPlayFootstep = true;
-        _camera.ProcessKeyboard(LEFT, deltaTime, speedIncrement);
-    }
-    if (InputManager::isKeyPressed(GLFW_KEY_D) && (!collisionResult.e || superSaiyan)) {
-        shouldPlayFootstep = true;
-        _camera.ProcessKeyboard(RIGHT, deltaTime, speedIncrement);
-    }
+    _slenderMan->setTransform(current.slenderTransform);
+    _lightUtils.setLightOn(current.lightOn);
 
-    if (glfwGetTime() - _lastPlayedFootstep > 0.8f && !AudioManager::getInstance().isPlayingFootstep() && shouldPlayFootstep) {
-        AudioManager::getInstance().playRandomFootstep();
-        _lastPlayedFootstep = glfwGetTime();
-    }
+    _menuOpen = current.menuOpen;
+    _camera.forceBlockCamera = _menuOpen;
 
-    if (InputManager::isKeyPressed(GLFW_KEY_F)) {
-        double currentTime = glfwGetTime();
-        if (currentTime - _previousTime > 0.3f) {
-            _previousTime = currentTime;
-            _lightUtils.flipLightOn();
-        }
+    _pageFramed = nullptr;
+    for (int i = 0; i < static_cast<int>(_pages.size()); i++) {
+        _pages[i]->setCollected(current.pagesCollected[i]);
+        _pages[i]->setFramed(i == current.framedPage);
+        if (i == current.framedPage)
+            _pageFramed = _pages[i];
     }
 
-    if (InputManager::isLeftMouseButtonPressed() && _pageFramed != nullptr && !_pageFramed->isCollected()) {
-        _pageFramed->setCollected(true);
-        _collectedPages++;
-        _loseThreshold = 1.0f - _collectedPages * THRESHOLD_OFFSET;
-        _pageCollectedTime = glfwGetTime();
-        AudioManager::getInstance().playSfx(ESfx::paper);
+    if (current.collectedPages != _collectedPages) {
+        _collectedPages = current.collectedPages;
+        _pageCollectedTime = current.pageCollectedTime;
 
         std::stringstream ssPageInfo;
         ssPageInfo << "Collected Page: " << _collectedPages << "/" << NUM_PAGES;
@@ -221,104 +223,114 @@ void GameScene::_processInput(const float& deltaTime, const CollisionResult& col
     }
 }
 
-void GameScene::_findFramedPage() {
-    for (auto page : _pages) {
-        page->setFramed(false);
-
-        const glm::vec3& translationVec = page->getRelatedPOITranslation();
-        float streetlampX = translationVec.x + STREETLIGHT_POI_OFFSET;
-        float streetlightZ = translationVec.z + STREETLIGHT_POI_OFFSET;
+void GameScene::process(const FrameClock& clock) {
+    _frameTime = clock.time;
 
-        float streetlightDistance = sqrt(pow(streetlampX - _camera.Position.x, 2) + pow(streetlightZ - _camera.Position.z, 2));
-        bool collectPosition = (_camera.Position.x > streetlampX && streetlightDistance <= PAGE_SELECTION_DISTANCE);
-
-        float z = streetlightZ - _camera.Position.z;
-        float alpha = z / streetlightDistance;
-        bool collectVision = (_camera.Front.x > X_V_MIN_PAGE && _camera.Front.x < X_V_MAX_PAGE)
-            && (_camera.Front.y > Y_V_MIN_PAGE && _camera.Front.y < Y_V_MAX_PAGE)
-            && (_camera.Front.z > (Z_V_MIN_PAGE + alpha) && _camera.Front.z < (Z_V_MAX_PAGE + alpha))
-            && (abs(alpha) < MAX_ANGLE_PAGE);
-
-        if (collectPosition && collectVision) {
-            page->setFramed(true);
-            _pageFramed = page;
-            return;
-        }
-    }
-
-    _pageFramed = nullptr;
-}
-
-void GameScene::process(const float& deltaTime) {
     if (_startTime < 0) {
-        _startTime = glfwGetTime();
+        _startTime = clock.time;
+        // Registrando o riproducendo l'input la partita deve dipendere solo dai frame: simulazione in lockstep.
+        // Lo spawn di Slenderman e' estratto dal seed della partita, lo stesso nella riproduzione
+        bool lockstep = InputRecorder::getInstance().isActive();
+        _simulation = new GameSimulation(_camera, _collisionSolver, _slendermanSpawnPoints, _pages, _slenderMan->transform(), _mapSeed, clock.time, lockstep);
+        _simulation->start();
         return;
     }
 
-    if (_collectedPages == NUM_PAGES) {
+    _simulation->pushInput(_sampleInput(), clock);
+    _processSimEvents();
+
+    bool wasMenuOpen = _menuOpen;
+    _applySnapshot(clock);
+
+    if (_currentSnapshot.outcome == EGameOutcome::win) {
         AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, 0);
         AudioManager::getInstance().setMusicVolume(EMusic::highFear, 0);
         AudioManager::getInstance().pauseMusic(EMusic::background);
 
         if (_timerTransition == 0) {
-            _timerTransition = glfwGetTime();
+            _timerTransition = clock.time;
         }
         _winImage->render(_camera, _lightUtils);
-        if (glfwGetTime() - _timerTransition > 3) {
+        if (clock.time - _timerTransition > 3) {
             _sceneManager->changeScene(EScene::menu);
         }
         return;
     }
 
-    if (_fearFactor >= _loseThreshold) {
+    if (_currentSnapshot.outcome == EGameOutcome::lose) {
         AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, 0);
         AudioManager::getInstance().setMusicVolume(EMusic::highFear, 0);
         AudioManager::getInstance().pauseMusic(EMusic::background);
 
         if (_timerTransition == 0) {
-            _timerTransition = glfwGetTime();
+            _timerTransition = clock.time;
         }
         _loseImage->render(_camera, _lightUtils);
-        if (glfwGetTime() - _timerTransition > 3) {
+        if (clock.time - _timerTransition > 3) {
             _sceneManager->changeScene(EScene::menu);
         }
         return;
     }
 
-    CollisionResult collisionResult = _collisionSolver.checkCollisionWithRegisteredAABBs(_camera, fmaxf(5.0f, (deltaTime * _camera.MovementSpeed) + 0.5f));
-    _processInput(deltaTime, collisionResult);
-
-    if (_shouldQuit)
+    if (_currentSnapshot.quitRequested) {
+        AudioManager::getInstance().pauseMusic(EMusic::background);
+        _sceneManager->changeScene(EScene::menu);
         return;
+    }
 
     if (_menuOpen) {
+        if (!wasMenuOpen) {
+            AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, 0);
+            AudioManager::getInstance().setMusicVolume(EMusic::highFear, 0);
+        }
+
         _menuIngame->render(_camera, _lightUtils);
         RenderText("[Esc] Return to Game", SCR_WIDTH / 2 - 200, 150, 0.8, glm::vec3(1, 1, 1));
         RenderText("[M] Quit to Menu", SCR_WIDTH / 2 - 150, 100, 0.8, glm::vec3(1, 1, 1));
-        _slenderManager->resetFearUpdateTime();
         return;
     }
 
-    _findFramedPage();
-
-    _slenderManager->updateSlenderman(_camera, *_slenderMan, _slendermanSpawnPoints, _collectedPages);
+    AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, _currentSnapshot.fearFactor);
+    AudioManager::getInstance().setMusicVolume(EMusic::highFear, _currentSnapshot.fearFactor);
 
-    _fearFactor = _slenderManager->updateFearFactor(_camera, _fearFactor);
+    FrameConstantsBuffer::getInstance().update(_camera);
 
+    for (auto renderable : WorldCache::getInstance().renderables())
+        renderable->submit(_renderQueue, _camera);
     for (auto renderable : _renderables)
-        renderable->render(_camera, _lightUtils);
+        renderable->submit(_renderQueue, _camera);
+
+    // La scena 3D va nel render target a risoluzione dinamica, minimappa, paura e testo restano a risoluzione nativa.
+    // La profondita' per l'occlusion culling si cattura dopo opachi e pagine, prima di debug e overlay
+    const FrameConstants& frameConstants = FrameConstantsBuffer::getInstance().constants();
+    if (USE_DYNAMIC_RESOLUTION) {
+        _dynamicResolution.beginScene();
+        _renderQueue.flush(_camera, _lightUtils, ERenderPass::stencil);
+        if (USE_OCCLUSION_CULLING)
+            OcclusionCuller::getInstance().capture(_dynamicResolution.framebuffer(), _dynamicResolution.viewportWidth(), _dynamicResolution.viewportHeight(), frameConstants.viewProjection, frameConstants.projection);
+        _renderQueue.flush(_camera, _lightUtils, ERenderPass::debug);
+        _dynamicResolution.endScene();
+    }
+    else if (USE_OCCLUSION_CULLING) {
+        _renderQueue.flush(_camera, _lightUtils, ERenderPass::stencil);
+        OcclusionCuller::getInstance().capture(0, SCR_WIDTH, SCR_HEIGHT, frameConstants.viewProjection, frameConstants.projection);
+    }
+    _renderQueue.flush(_camera, _lightUtils);
+
+    if (_pageFramed != nullptr && !_pageFramed->isCollected())
+        RenderText("Click left mouse button to collect the page", (SCR_WIDTH / 2) - 275.0f, 200.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
 
-    if (!_collectedPageMessage.empty() && _pageCollectedTime + PAGE_COLLECTED_MESSAGE_SECONDS > glfwGetTime())
+    if (!_collectedPageMessage.empty() && _pageCollectedTime + PAGE_COLLECTED_MESSAGE_SECONDS > _currentSnapshot.simulationTime)
         RenderText(_collectedPageMessage, (SCR_WIDTH / 2) - 150.0f, SCR_HEIGHT - 200.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
 
     if (DEBUG)
         _renderInfo();
 
-    if (glfwGetTime() - _startTime < 7) {
+    if (clock.time - _startTime < 7) {
         RenderText("Find all the pages to win", SCR_WIDTH / 2 - 200.0f, SCR_HEIGHT - 100.0f, 0.65f, glm::vec3(1.0f, 1.0f, 1.0f));
     }
 
-    if (glfwGetTime() - _startTime > 7 && glfwGetTime() - _startTime < 11) {
+    if (clock.time - _startTime > 7 && clock.time - _startTime < 11) {
         RenderText("[Esc] to open menu [F] to turn on/off flashlight", SCR_WIDTH / 2 - 450.0f, SCR_HEIGHT - 100.0f, 0.65f, glm::vec3(1.0f, 1.0f, 1.0f));
     }
 }
@@ -342,21 +354,114 @@ void GameScene::_renderInfo() {
     ssfrontinfo << "x_v: " << _camera.Front.x << " y_v: " << _camera.Front.y << " z_v: " << _camera.Front.z;
     std::string front_info = ssfrontinfo.str();
     RenderText(front_info, 100.0f, 50.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    const GLStateStats& stateStats = GLStateCache::getInstance().lastFrameStats();
+    std::stringstream ssstate;
+    ssstate << "gl state: " << stateStats.issued << " issued " << stateStats.elided << " elided";
+    std::string state = ssstate.str();
+    RenderText(state, 100.0f, 70.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    std::stringstream ssresolution;
+    ssresolution << "scale: " << _dynamicResolution.scale() << " gpu: " << _dynamicResolution.gpuTime() << "ms";
+    std::string resolution = ssresolution.str();
+    RenderText(resolution, 100.0f, 90.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    TextureStreamingStats streamingStats = TextureStreamer::getInstance().stats();
+    std::stringstream ssstreaming;
+    ssstreaming << "textures: " << streamingStats.textures << " resident " << streamingStats.residentBytes / (1024 * 1024) << "/" << streamingStats.fullBytes / (1024 * 1024)
+        << "MB uploads " << streamingStats.uploadedLevels << " evictions " << streamingStats.evictedLevels;
+    std::string streaming = ssstreaming.str();
+    RenderText(streaming, 100.0f, 110.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    GLResourceRegistry& registry = GLResourceRegistry::getInstance();
+    std::stringstream ssresources;
+    ssresources << "gl objects: " << registry.liveObjects() << " " << registry.totalBytes() / (1024 * 1024) << "MB (textures " << registry.stats(EGLResource::texture).bytes / (1024 * 1024)
+        << "MB buffers " << registry.stats(EGLResource::buffer).bytes / (1024 * 1024) << "MB)";
+    std::string resources = ssresources.str();
+    RenderText(resources, 100.0f, 130.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    std::stringstream ssstatic;
+    ssstatic << "static model draws: " << StaticGeometry::getInstance().takeDrawCount();
+    std::string staticDraws = ssstatic.str();
+    RenderText(staticDraws, 100.0f, 150.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    const OcclusionStats& occlusionStats = OcclusionCuller::getInstance().lastFrameStats();
+    std::stringstream ssocclusion;
+    int chunk = static_cast<int>(EOcclusionGroup::chunk);
+    int object = static_cast<int>(EOcclusionGroup::object);
+    ssocclusion << "culling: chunks " << occlusionStats.drawn(EOcclusionGroup::chunk) << "/" << occlusionStats.tested[chunk]
+        << " drawn (frustum " << occlusionStats.outsideFrustum[chunk] << " occluded " << occlusionStats.occluded[chunk] << ") objects "
+        << occlusionStats.drawn(EOcclusionGroup::object) << "/" << occlusionStats.tested[object]
+        << " drawn (frustum " << occlusionStats.outsideFrustum[object] << " occluded " << occlusionStats.occluded[object] << ")";
+    std::string occlusion = ssocclusion.str();
+    RenderText(occlusion, 100.0f, 170.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    const StreamingStats& streamStats = StreamingBuffer::getInstance().lastFrameStats();
+    std::stringstream ssstream;
+    ssstream << "stream: " << streamStats.bytes / 1024 << "KB in " << streamStats.allocations << " uploads, stalls " << streamStats.stalls << " orphans " << streamStats.orphans;
+    std::string stream = ssstream.str();
+    RenderText(stream, 100.0f, 190.0f, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+
+    // Raccogliere le statistiche visita tutti gli AABB: non si ripete a ogni frame
+    // Tempo del FrameClock: in riproduzione l'aggiornamento segue il clock registrato
+    double now = _frameTime;
+    if (_memoryStatsTime < 0.0 || now - _memoryStatsTime > MEMORY_STATS_REFRESH_SECONDS) {
+        _memoryEntries = MemoryStats::getInstance().collect();
+        _memoryStatsTime = now;
+    }
+    float y = 150.0f;
+    for (const auto& entry : _memoryEntries) {
+        std::stringstream ssmemory;
+        ssmemory << entry.name << ": cpu " << entry.usage.cpuBytes / (1024 * 1024) << "MB gpu " << entry.usage.gpuBytes / (1024 * 1024) << "MB";
+        std::string memory = ssmemory.str();
+        RenderText(memory, SCR_WIDTH - 450.0f, y, 0.5f, glm::vec3(1.0f, 1.0f, 1.0f));
+        y += 20.0f;
+    }
 }
 
 void GameScene::destroy() {
+    // La simulazione legge collision solver e spawn point: va fermata prima di liberarli
+    if (_simulation != nullptr) {
+        _simulation->stop();
+        delete _simulation;
+        _simulation = nullptr;
+    }
+
+    _dynamicResolution.destroy();
+
+    if (DEBUG && !MemoryStats::getInstance().dumpJson(MEMORY_REPORT_PATH))
+        std::cout << "WARNING::MEMORY:: Could not write " << MEMORY_REPORT_PATH << std::endl;
+    MemoryStats::getInstance().remove(this);
+    MemoryStats::getInstance().remove(&_collisionSolver);
+
     for (auto renderable : _renderables)
         delete renderable;
     _renderables.clear();
     _renderables.shrink_to_fit();
 
+    for (auto page : _pages)
+        delete page;
+    _pages.clear();
+
+    // Gli AABB del mondo restano nella WorldCache per la prossima partita
     _collisionSolver.clearRegisteredAABBs();
 
     delete _tabooIndices;
-    delete _slenderManager;
     delete _menuIngame;
     delete _winImage;
     delete _loseImage;
+
+    // Quello che resta e' delle cache: tra una partita e l'altra deve rimanere costante
+    if (DEBUG)
+        GLResourceRegistry::getInstance().report(std::cout);
+}
+
+MemoryUsage GameScene::memoryUsage() const {
+    MemoryUsage usage;
+    for (auto renderable : _renderables)
+        usage += renderable->memoryUsage();
+    usage.cpuBytes += vectorBytes(_renderables) + vectorBytes(_pages) + _pages.size() * sizeof(Page);
+    return usage;
 }
 
 Camera* GameScene::currentCamera() {
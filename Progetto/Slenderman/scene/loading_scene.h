@@ -15,6 +15,7 @@
 #include "../model_cache.h"
 #include "../scene.h"
 #include "../shader_cache.h"
+#include "../static_geometry.h"
 #include "../texture_cache.h"
 #include "fullscreen_image.h"
 
@@ -40,7 +41,7 @@ public:
 
     virtual void init() override;
 
-    virtual void process(const float& deltaTime) override;
+    virtual void process(const FrameClock& clock) override;
 
     virtual void destroy() override;
 
@@ -55,16 +56,25 @@ void LoadingScene::_loadShaders() {
     ShaderCache::getInstance().registerShader(EShader::floor, new Shader("multiple_lights.vs", "multiple_lights.fs"));
     ShaderCache::getInstance().registerShader(EShader::streetLight, new Shader("multiple_lights.vs", "streetlight_shader.fs"));
     ShaderCache::getInstance().registerShader(EShader::tree, new Shader("multiple_lights_instancing.vs", "multiple_lights.fs"));
-    ShaderCache::getInstance().registerShader(EShader::grass, new Shader("multiple_lights_instancing.vs", "multiple_lights.fs"));
-    ShaderCache::getInstance().registerShader(EShader::poi, new Shader("multiple_lights.vs", "multiple_lights.fs"));
+    ShaderCache::getInstance().registerShader(EShader::grass, new Shader(PROCEDURAL_GRASS ? "grass_procedural.vs" : "multiple_lights_instancing.vs", "multiple_lights.fs"));
+    ShaderCache::getInstance().registerShader(EShader::poi, new Shader("multiple_lights_layer.vs", "multiple_lights_array.fs"));
     ShaderCache::getInstance().registerShader(EShader::minimap, new Shader("minimap_shader.vs", "minimap_shader.fs"));
     ShaderCache::getInstance().registerShader(EShader::minimapWood, new Shader("minimap_shader.vs", "minimap_shader.fs"));
     ShaderCache::getInstance().registerShader(EShader::minimapCircle, new Shader("circle_minimap.vs", "circle_minimap.fs"));
     ShaderCache::getInstance().registerShader(EShader::fence, new Shader("multiple_lights_instancing.vs", "multiple_lights.fs"));
-    ShaderCache::getInstance().registerShader(EShader::page, new Shader("multiple_lights.vs", "multiple_lights.fs"));
+    ShaderCache::getInstance().registerShader(EShader::page, new Shader("page_instancing.vs", "multiple_lights_array.fs"));
     ShaderCache::getInstance().registerShader(EShader::singleColor, new Shader("stencil_single_color.vs", "stencil_single_color.fs"));
     ShaderCache::getInstance().registerShader(EShader::aabb, new Shader("aabb.vs", "aabb.fs"));
     ShaderCache::getInstance().registerShader(EShader::fear, new Shader("fear.vs", "fear.fs"));
+    ShaderCache::getInstance().registerShader(EShader::impostor, new Shader("impostor.vs", "impostor.fs"));
+    ShaderCache::getInstance().registerShader(EShader::impostorBake, new Shader("impostor_bake.vs", "impostor_bake.fs"));
+    ShaderCache::getInstance().registerShader(EShader::hiZReduce, new Shader("hi_z_reduce.vs", "hi_z_reduce.fs"));
+
+    for (EShader key : { EShader::poi, EShader::page }) {
+        Shader* shader = ShaderCache::getInstance().findShader(key);
+        shader->use();
+        shader->setInt("diffuseArray", TEXTURE_ARRAY_UNIT);
+    }
 }
 
 void LoadingScene::_loadTextures() {
@@ -80,21 +90,26 @@ void LoadingScene::_loadTextures() {
     TextureCache::getInstance().registerTexture(ETexture::loseImage, "resources/textures/lose_image.jpg");
     TextureCache::getInstance().registerTexture(ETexture::winImage, "resources/textures/win_image.jpg");
 
+    // POI e pagine come layer di due texture array: un solo bind per tutti i POI e per tutte le pagine
+    vector<std::pair<ETexture, std::string>> poiLayers;
     int poi1TextureEnumIndex = static_cast<int>(ETexture::poi1);
     int poi8TextureEnumIndex = static_cast<int>(ETexture::poi8);
     for (int poiEnumIndex = poi1TextureEnumIndex; poiEnumIndex <= poi8TextureEnumIndex; poiEnumIndex++) {
         int poiIndex = (poiEnumIndex - poi1TextureEnumIndex) + 1;
         std::string texturePath = "resources/models/Points of interest/" + std::to_string(poiIndex) + "/" + std::to_string(poiIndex) + ".jpg";
-        TextureCache::getInstance().registerTexture(static_cast<ETexture>(poiEnumIndex), texturePath.c_str());
+        poiLayers.push_back(std::make_pair(static_cast<ETexture>(poiEnumIndex), texturePath));
     }
+    TextureCache::getInstance().registerTextureArray(ETextureArray::poi, poiLayers);
 
+    vector<std::pair<ETexture, std::string>> pageLayers;
     int page1TextureEnumIndex = static_cast<int>(ETexture::page1);
     int page8TextureEnumIndex = static_cast<int>(ETexture::page8);
     for (int pageEnumIndex = page1TextureEnumIndex; pageEnumIndex <= page8TextureEnumIndex; pageEnumIndex++) {
         int pageIndex = (pageEnumIndex - page1TextureEnumIndex) + 1;
-        std::string texturePath = "resources/textures/Pages/page_" + std::to_string(pageIndex) + ".jpg";;
-        TextureCache::getInstance().registerTexture(static_cast<ETexture>(pageEnumIndex), texturePath.c_str());
+        std::string texturePath = "resources/textures/Pages/page_" + std::to_string(pageIndex) + ".jpg";
+        pageLayers.push_back(std::make_pair(static_cast<ETexture>(pageEnumIndex), texturePath));
     }
+    TextureCache::getInstance().registerTextureArray(ETextureArray::page, pageLayers);
 }
 
 void LoadingScene::_loadModels() {
@@ -115,6 +130,12 @@ void LoadingScene::_loadModels() {
         std::string modelPath = "resources/models/Points of interest/" + std::to_string(poiIndex) + "/" + std::to_string(poiIndex) + extensions[poiIndex - 1];
         ModelCache::getInstance().registerModel(static_cast<EModel>(poiEnumIndex), new Model(modelPath));
     }
+
+    // Modelli disegnati da ModelRenderable: un unico buffer condiviso
+    vector<Model*> staticModels = { ModelCache::getInstance().findModel(EModel::slenderMan), ModelCache::getInstance().findModel(EModel::streetLight) };
+    for (int poiEnumIndex = poi1ModelEnumIndex; poiEnumIndex <= poi8ModelEnumIndex; poiEnumIndex++)
+        staticModels.push_back(ModelCache::getInstance().findModel(static_cast<EModel>(poiEnumIndex)));
+    StaticGeometry::getInstance().build(staticModels);
 }
 
 void LoadingScene::_loadAudio() {
@@ -140,7 +161,6 @@ void LoadingScene::_renderActualInfo(std::string text) {
 
 void LoadingScene::init() {
     _menuImage = new FullsceenImage(ETexture::menuImage);
-    initRenderText(SCR_WIDTH, SCR_HEIGHT);
     _renderActualInfo("Loading audio...");
     _loadAudio();
     _renderActualInfo("Loading shaders...");
@@ -157,18 +177,22 @@ void LoadingScene::init() {
     AudioManager::getInstance().playMusicFromBeginning(EMusic::background, 0.15f);
 }
 
-void LoadingScene::process(const float& deltaTime) {
+void LoadingScene::process(const FrameClock& clock) {
     if (InputManager::isKeyPressed(GLFW_KEY_SPACE) && !_transitionStarted) {
         _transitionStarted = true;
-        _transitionStartedTime = glfwGetTime();
+        _transitionStartedTime = clock.time;
     }
 
     if (!_transitionStarted) {
         _menuImage->render(_camera, _lightUtils);
         RenderText("Loading done: press [space] to play", SCR_WIDTH / 2 - 400, 80, 0.8, glm::vec3(1, 1, 1));
+
+        unsigned int pendingTextures = TextureUploadQueue::getInstance().pending();
+        if (pendingTextures > 0)
+            RenderText("Streaming textures: " + std::to_string(pendingTextures), SCR_WIDTH / 2 - 400, 40, 0.5, glm::vec3(1, 1, 1));
     }
 
-    if (_transitionStarted && glfwGetTime() - _transitionStartedTime > 1) {
+    if (_transitionStarted && clock.time - _transitionStartedTime > 1) {
         AudioManager::getInstance().playSfx(ESfx::lightOn);
         _sceneManager->changePreloadedScene(_gameScene);
     }
@@ -2,6 +2,8 @@
 
 #include <map>
 
+#include "frame_constants.h"
+#include "memory_stats.h"
 #include "shader_m.h"
 
 enum class EShader {
@@ -20,13 +22,16 @@ enum class EShader {
     aabb,
     fear,
     fullScreenImage,
+    impostor,
+    impostorBake,
+    hiZReduce,
 };
 
-class ShaderCache {
+class ShaderCache : public MemoryReporter {
 private:
     std::map<EShader, Shader*> _shaderCache;
 
-    ShaderCache() {}
+    ShaderCache() { MemoryStats::getInstance().add("shaders", this); }
 
 public:
     ShaderCache(ShaderCache const&) = delete;
@@ -41,6 +46,9 @@ public:
     void clear();
 
     inline bool has(EShader key) const { return _shaderCache.find(key) != _shaderCache.end(); }
+
+    // I programmi linkati non hanno una dimensione interrogabile: conta solo la parte CPU
+    virtual MemoryUsage memoryUsage() const override;
 };
 
 ShaderCache& ShaderCache::getInstance() {
@@ -53,12 +61,19 @@ void ShaderCache::registerShader(EShader key, Shader* value) {
         return;
 
     _shaderCache[key] = value;
+    FrameConstantsBuffer::getInstance().bindProgram(value->ID);
 }
 
 Shader* ShaderCache::findShader(EShader key) {
     return _shaderCache[key];
 }
 
+MemoryUsage ShaderCache::memoryUsage() const {
+    MemoryUsage usage;
+    usage.cpuBytes = _shaderCache.size() * sizeof(Shader);
+    return usage;
+}
+
 void ShaderCache::clear() {
     for (auto pair : _shaderCache)
         delete pair.second;
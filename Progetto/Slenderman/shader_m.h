@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gl_resource.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -81,7 +83,8 @@ public:
       checkCompileErrors(geometry, "GEOMETRY");
     }
     // shader Program
-    ID = glCreateProgram();
+    program = GLProgram::create();
+    ID = program.id();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
     if (geometryPath != nullptr)
@@ -161,6 +164,9 @@ public:
   }
 
 private:
+  // the program is deleted together with the shader
+  GLProgram program;
+
   // utility function for checking shader compilation/linking errors.
   // ------------------------------------------------------------------------
   void checkCompileErrors(GLuint shader, std::string type)
@@ -9,50 +9,49 @@
 #include "../audio_manager.h"
 #include "../camera.h"
 #include "../slenderman.h"
+#include "../spawn_point_grid.h"
 
 class SlenderManager {
 public:
-    float _previousTime = glfwGetTime();
+    // Istante (tempo di simulazione) dell'ultimo spawn
+    double _previousTime = 0.0;
     glm::vec3 _slendermanTranslationVector = glm::vec3(0.0f, -15.8f, -10000.0f);
     float _fearFactor = 0.0f;
-    float _fearUpdateTime = glfwGetTime();
 
     SlenderManager() {};
 
-    void updateSlenderman(const Camera& camera, SlenderMan& slenderman, const std::vector<glm::vec3>& slendermanSpawnPoints, const int collectedPages);
+    // spawnDraw conta le estrazioni dello spawn e avanza a ogni tentativo
+    glm::mat4 updateSlenderman(const Camera& camera, const SpawnPointGrid& slendermanSpawnPoints, const int collectedPages, const double simulationTime, const uint32_t spawnSeed, uint32_t& spawnDraw);
 
-    float updateFearFactor(const Camera& camera, const float previousFearFactor);
-
-    void resetFearUpdateTime();
+    // deltaTime e' il passo fisso della simulazione
+    float updateFearFactor(const Camera& camera, const float previousFearFactor, const float deltaTime);
 
 private:
     glm::mat4 _getSlendemanShaderModel(const Camera& camera);
 
     float _calcSlenderRotationAngle(const Camera& camera);
 
-    vector<glm::vec3> _getNearSpawnPoints(const Camera camera, const std::vector<glm::vec3> slendermanSpawnPoints, const int collectedPages);
-
     float _calcNegativeFearFactor(float distance, float angle, float timeDifference);
 
     float _calcPositiveFearFactor(float distance, float angle, float timeDifference);
 };
 
-void SlenderManager::updateSlenderman(const Camera& camera, SlenderMan& slenderman, const std::vector<glm::vec3>& slendermanSpawnPoints, const int collectedPages) {
-    if (glfwGetTime() - _previousTime > TIME_SPAWN_SLENDER_FACTOR * (NUM_PAGES - collectedPages) && _fearFactor == 0) {
-        vector<glm::vec3> nearSpawnPoints = _getNearSpawnPoints(camera, slendermanSpawnPoints, collectedPages);
-        if (nearSpawnPoints.empty()) {
-            return;
+glm::mat4 SlenderManager::updateSlenderman(const Camera& camera, const SpawnPointGrid& slendermanSpawnPoints, const int collectedPages, const double simulationTime, const uint32_t spawnSeed, uint32_t& spawnDraw) {
+    if (simulationTime - _previousTime > TIME_SPAWN_SLENDER_FACTOR * (NUM_PAGES - collectedPages) && _fearFactor == 0) {
+        // Un punto a caso nella corona davanti alla camera, che si stringe a ogni pagina raccolta
+        float minDistance = MAX_INTERNAL_SPAWN_DISTANCE - SPAWN_OFFSET_PER_PAGE * collectedPages;
+        float maxDistance = MAX_EXTERNAL_SPAWN_DISTANCE - SPAWN_OFFSET_PER_PAGE * collectedPages;
+        glm::vec3 spawnPoint;
+        if (slendermanSpawnPoints.sampleInAnnulusCone(camera.Position, camera.Front, minDistance, maxDistance, HALF_CONE_OPENING, spawnSeed, spawnDraw++, spawnPoint)) {
+            _slendermanTranslationVector = spawnPoint;
+            _previousTime = simulationTime;
         }
-        int spawnPointIndex = rand() % nearSpawnPoints.size();
-        _slendermanTranslationVector = nearSpawnPoints[spawnPointIndex];
-        _previousTime = glfwGetTime();
     }
 
-    glm::mat4 slenderTransform = _getSlendemanShaderModel(camera);
-    slenderman.setTransform(slenderTransform);
+    return _getSlendemanShaderModel(camera);
 }
 
-float SlenderManager::updateFearFactor(const Camera& camera, const float previousFearFactor) {
+float SlenderManager::updateFearFactor(const Camera& camera, const float previousFearFactor, const float deltaTime) {
     float slenderDistance = sqrt(pow(_slendermanTranslationVector.x - camera.Position.x, 2) + pow(_slendermanTranslationVector.z - camera.Position.z, 2));
     if (slenderDistance > DISTANCE_RESET_FEAR) {
         if (previousFearFactor > 0.05)
@@ -66,24 +65,16 @@ float SlenderManager::updateFearFactor(const Camera& camera, const float previou
         if (slenderAngle < 0) {
             slenderAngle = slenderAngle + 360.0f;
         }
-        float timeDifference = glfwGetTime() - _fearUpdateTime;
         if (slenderAngle >= HALF_SLENDER_CONE_OPENING && slenderAngle <= 360.0f - HALF_SLENDER_CONE_OPENING) {
-            _fearFactor = std::max(0.0f, _fearFactor - _calcNegativeFearFactor(slenderDistance, slenderAngle, timeDifference));
+            _fearFactor = std::max(0.0f, _fearFactor - _calcNegativeFearFactor(slenderDistance, slenderAngle, deltaTime));
         }
         else {
-            _fearFactor = std::min(1.0f, _fearFactor + _calcPositiveFearFactor(slenderDistance, slenderAngle, timeDifference));
+            _fearFactor = std::min(1.0f, _fearFactor + _calcPositiveFearFactor(slenderDistance, slenderAngle, deltaTime));
         }
     }
-    AudioManager::getInstance().setMusicVolume(EMusic::whiteNoise, _fearFactor);
-    AudioManager::getInstance().setMusicVolume(EMusic::highFear, _fearFactor);
-    _fearUpdateTime = glfwGetTime();
     return _fearFactor;
 }
 
-void SlenderManager::resetFearUpdateTime() {
-    _fearUpdateTime = glfwGetTime();
-}
-
 glm::mat4 SlenderManager::_getSlendemanShaderModel(const Camera& camera) {
     glm::mat4 slendermanShaderModel = glm::mat4(1.0f);
     slendermanShaderModel = glm::translate(slendermanShaderModel, _slendermanTranslationVector);
@@ -109,29 +100,6 @@ float SlenderManager::_calcSlenderRotationAngle(const Camera& camera) {
     return rotationAngle;
 }
 
-vector<glm::vec3> SlenderManager::_getNearSpawnPoints(Camera camera, std::vector<glm::vec3> slendermanSpawnPoints, const int collectedPages) {
-    vector<glm::vec3> nearSpawnPoints;
-    for (int i = 0; i < slendermanSpawnPoints.size(); i++) {
-        float pointCameraDistance = sqrt(pow(slendermanSpawnPoints[i].x - camera.Position.x, 2) + pow(slendermanSpawnPoints[i].z - camera.Position.z, 2));
-        if (pointCameraDistance > (MAX_EXTERNAL_SPAWN_DISTANCE - SPAWN_OFFSET_PER_PAGE * collectedPages)) {
-            continue;
-        }
-        if (pointCameraDistance < (MAX_INTERNAL_SPAWN_DISTANCE - SPAWN_OFFSET_PER_PAGE * collectedPages)) {
-            continue;
-        }
-        float angle = atan2((slendermanSpawnPoints[i].x - camera.Position.x), (slendermanSpawnPoints[i].z - camera.Position.z)) - atan2(camera.Front.x, camera.Front.z);
-        angle = angle * 180 / M_PI;
-        if (angle < 0) {
-            angle = angle + 360.0f;
-        }
-        if (angle >= HALF_CONE_OPENING && angle <= 360.0f - HALF_CONE_OPENING) {
-            continue;
-        }
-        nearSpawnPoints.push_back(slendermanSpawnPoints[i]);
-    }
-    return nearSpawnPoints;
-}
-
 float SlenderManager::_calcNegativeFearFactor(float distance, float angle, float timeDifference) {
     float fearFactor = (1.0f / (MEDIUM_TIME_DEATH * 2)) * (distance) / DISTANCE_RESET_FEAR;
     if (angle <= 180.0f) {
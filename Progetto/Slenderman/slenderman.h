@@ -2,6 +2,7 @@
 
 #include "light_utils.h"
 #include "model_cache.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
@@ -10,10 +11,13 @@ class SlenderMan : public ModelRenderable {
 public:
     SlenderMan();
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 
     void setTransform(glm::mat4 transform) {
         _transform = transform;
+        _normalMatrix = _normalMatrixOf(_transform);
     }
 };
 
@@ -26,19 +30,26 @@ SlenderMan::SlenderMan(){
     transform = glm::translate(transform, glm::vec3(0.0f, -0.8f, -10000.0f));
     transform = glm::scale(transform, glm::vec3(0.01f, 0.01f, 0.01f));
     _transform = transform;
+    _normalMatrix = _normalMatrixOf(_transform);
 }
 
-void SlenderMan::render(const Camera& camera, const LightUtils& lightUtils) {
-    lightUtils.initLightShader(_shader, camera);
-
-    _shader->use();
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+void SlenderMan::submit(RenderQueue& queue, const Camera& camera) {
+    if (!_isVisible())
+        return;
+
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.texture = _texture;
+    packet.VAO = StaticGeometry::getInstance().VAO();
+    packet.usesLights = true;
+    packet.distance = _distanceFrom(camera);
+    queue.submit(packet);
+}
 
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
+void SlenderMan::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
     _shader->setMat4("model", _transform);
-
-    _model->Draw(*_shader);
+    _shader->setMat3("normalMatrix", _normalMatrix);
+    _drawModel(packet.distance);
 }
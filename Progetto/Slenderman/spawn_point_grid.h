@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "constants.h"
+#include "map_random.h"
+
+// Griglia uniforme sul piano xz dei punti di spawn, costruita una volta alla generazione della mappa.
+// I punti sono ordinati per cella e ogni cella e' un intervallo [_cellStart[c], _cellStart[c + 1]) in _points:
+// le query visitano solo le celle che intersecano il cerchio esterno e non allocano memoria
+class SpawnPointGrid {
+private:
+    std::vector<glm::vec3> _points;
+    std::vector<unsigned int> _cellStart;
+    glm::vec2 _origin = glm::vec2(0.0f);
+    int _cellsX = 0;
+    int _cellsZ = 0;
+
+    inline int _cellX(const float x) const { return std::min(std::max(static_cast<int>(floor((x - _origin.x) / SPAWN_GRID_CELL_SIZE)), 0), _cellsX - 1); }
+
+    inline int _cellZ(const float z) const { return std::min(std::max(static_cast<int>(floor((z - _origin.y) / SPAWN_GRID_CELL_SIZE)), 0), _cellsZ - 1); }
+
+public:
+    SpawnPointGrid() {}
+
+    SpawnPointGrid(const std::vector<glm::vec3>& points);
+
+    inline size_t size() const { return _points.size(); }
+
+    inline bool empty() const { return _points.empty(); }
+
+    // Visita i punti a distanza (sul piano xz) in [minDistance, maxDistance] da center e
+    // entro halfConeDegrees dalla direzione front
+    template <typename Visitor>
+    void forEachInAnnulusCone(const glm::vec3& center, const glm::vec3& front, const float minDistance, const float maxDistance, const float halfConeDegrees, Visitor&& visit) const;
+
+    // Sceglie in modo uniforme uno dei punti della query (reservoir sampling), false se non ce ne sono.
+    // La scelta dipende solo da (seed, draw): nessuno stato globale condiviso con gli altri thread
+    bool sampleInAnnulusCone(const glm::vec3& center, const glm::vec3& front, const float minDistance, const float maxDistance, const float halfConeDegrees, const uint32_t seed, const uint32_t draw, glm::vec3& result) const;
+};
+
+SpawnPointGrid::SpawnPointGrid(const std::vector<glm::vec3>& points) {
+    if (points.empty())
+        return;
+
+    glm::vec2 minCorner = glm::vec2(points[0].x, points[0].z);
+    glm::vec2 maxCorner = minCorner;
+    for (const auto& point : points) {
+        minCorner = glm::min(minCorner, glm::vec2(point.x, point.z));
+        maxCorner = glm::max(maxCorner, glm::vec2(point.x, point.z));
+    }
+
+    _origin = minCorner;
+    _cellsX = static_cast<int>(floor((maxCorner.x - minCorner.x) / SPAWN_GRID_CELL_SIZE)) + 1;
+    _cellsZ = static_cast<int>(floor((maxCorner.y - minCorner.y) / SPAWN_GRID_CELL_SIZE)) + 1;
+
+    // Counting sort dei punti per cella
+    std::vector<unsigned int> cellOf(points.size());
+    _cellStart.assign(static_cast<size_t>(_cellsX) * _cellsZ + 1, 0);
+    for (size_t i = 0; i < points.size(); i++) {
+        cellOf[i] = _cellX(points[i].x) * _cellsZ + _cellZ(points[i].z);
+        _cellStart[cellOf[i] + 1]++;
+    }
+    for (size_t c = 1; c < _cellStart.size(); c++)
+        _cellStart[c] += _cellStart[c - 1];
+
+    std::vector<unsigned int> cursor(_cellStart.begin(), _cellStart.end() - 1);
+    _points.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+        _points[cursor[cellOf[i]]++] = points[i];
+}
+
+template <typename Visitor>
+void SpawnPointGrid::forEachInAnnulusCone(const glm::vec3& center, const glm::vec3& front, const float minDistance, const float maxDistance, const float halfConeDegrees, Visitor&& visit) const {
+    if (_points.empty() || maxDistance < 0.0f)
+        return;
+
+    // Con la camera rivolta in verticale la direzione di riferimento e' +z, come atan2(0, 0)
+    glm::vec2 direction = glm::vec2(front.x, front.z);
+    float directionLength = glm::length(direction);
+    direction = directionLength > 0.0f ? direction / directionLength : glm::vec2(0.0f, 1.0f);
+
+    float minDistance2 = std::max(0.0f, minDistance) * std::max(0.0f, minDistance);
+    float maxDistance2 = maxDistance * maxDistance;
+    float cosCone = cos(glm::radians(halfConeDegrees));
+
+    int minX = _cellX(center.x - maxDistance);
+    int maxX = _cellX(center.x + maxDistance);
+    int minZ = _cellZ(center.z - maxDistance);
+    int maxZ = _cellZ(center.z + maxDistance);
+
+    for (int x = minX; x <= maxX; x++) {
+        for (int z = minZ; z <= maxZ; z++) {
+            int cell = x * _cellsZ + z;
+            for (unsigned int i = _cellStart[cell]; i < _cellStart[cell + 1]; i++) {
+                const glm::vec3& point = _points[i];
+                glm::vec2 toPoint = glm::vec2(point.x - center.x, point.z - center.z);
+                float distance2 = glm::dot(toPoint, toPoint);
+                if (distance2 < minDistance2 || distance2 > maxDistance2 || distance2 == 0.0f)
+                    continue;
+
+                // Angolo tra la direzione del punto e la vista senza atan2 ne' sqrt: dot >= cos(cono) * |toPoint|,
+                // elevato al quadrato conservando il segno
+                float projection = glm::dot(toPoint, direction);
+                if (projection * std::abs(projection) < cosCone * std::abs(cosCone) * distance2)
+                    continue;
+
+                visit(point);
+            }
+        }
+    }
+}
+
+bool SpawnPointGrid::sampleInAnnulusCone(const glm::vec3& center, const glm::vec3& front, const float minDistance, const float maxDistance, const float halfConeDegrees, const uint32_t seed, const uint32_t draw, glm::vec3& result) const {
+    unsigned int found = 0;
+    forEachInAnnulusCone(center, front, minDistance, maxDistance, halfConeDegrees, [&](const glm::vec3& point) {
+        found++;
+        if (MapRandom::randomInt(seed, draw, found, found) == 0)
+            result = point;
+    });
+    return found > 0;
+}
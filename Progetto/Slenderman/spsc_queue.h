@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Coda circolare senza lock per un solo produttore e un solo consumatore.
+// Gli slot sono allocati una volta: push e pop non prendono mutex, se la coda e' piena push fallisce
+template <typename T, size_t Capacity>
+class SpscQueue {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "La capacita' deve essere una potenza di due");
+
+    T _slots[Capacity];
+    // Indici monotoni: head e' scritto solo dal consumatore, tail solo dal produttore
+    alignas(64) std::atomic<size_t> _head{ 0 };
+    alignas(64) std::atomic<size_t> _tail{ 0 };
+
+public:
+    bool push(T&& value);
+
+    bool pop(T& value);
+
+    inline size_t size() const { return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire); }
+};
+
+template <typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::push(T&& value) {
+    size_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == Capacity)
+        return false;
+
+    _slots[tail & (Capacity - 1)] = std::move(value);
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::pop(T& value) {
+    size_t head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire))
+        return false;
+
+    value = std::move(_slots[head & (Capacity - 1)]);
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_resource.h"
+#include "gl_state_cache.h"
+#include "memory_stats.h"
+#include "model.h"
+#include "occlusion_culler.h"
+#include "shader_m.h"
+#include "texture_cache.h"
+#include "texture_streamer.h"
+
+// Solo gli attributi letti da multiple_lights.vs, senza tangenti e bitangenti
+struct StaticVertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+};
+
+// Mesh di un modello con la stessa texture diffuse: una sola glMultiDrawElementsBaseVertex
+struct StaticDrawBatch {
+    unsigned int texture = 0;   // 0 se le mesh non hanno texture, si usa quella della renderable
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+};
+
+// Geometria dei modelli statici (POI, lampioni, Slenderman) in un unico vertex buffer e index buffer con un solo VAO.
+// Ogni modello si disegna con una chiamata per texture invece di un bind del VAO, un ciclo di bind delle texture e
+// una glGetUniformLocation per ogni mesh. I buffer delle singole mesh vengono liberati, sulla CPU restano i vertici per gli AABB
+class StaticGeometry : public MemoryReporter {
+private:
+    StaticGeometry() { MemoryStats::getInstance().add("static geometry", this); }
+
+    GLVertexArray _VAO;
+    GLBuffer _VBO;
+    GLBuffer _EBO;
+
+    std::map<const Model*, std::vector<StaticDrawBatch>> _batches;
+    std::map<const Model*, CullBounds> _bounds;
+    unsigned int _draws = 0;
+
+    void _drawBatch(const StaticDrawBatch& batch);
+
+public:
+    StaticGeometry(StaticGeometry const&) = delete;
+    void operator=(StaticGeometry const&) = delete;
+
+    static StaticGeometry& getInstance() {
+        static StaticGeometry instance;
+        return instance;
+    }
+
+    // Impacchetta i modelli, da chiamare una volta dopo il caricamento
+    void build(const std::vector<Model*>& models);
+
+    inline bool isBuilt() const { return static_cast<bool>(_VAO); }
+
+    inline unsigned int VAO() const { return _VAO.id(); }
+
+    // Volume del modello nelle sue coordinate locali, calcolato durante l'impacchettamento
+    inline const CullBounds& bounds(const Model& model) const { return _bounds.at(&model); }
+
+    // Con il VAO condiviso gia' bindato. fallbackTexture va sull'unita' 0 per le mesh senza texture
+    void draw(const Model& model, const unsigned int fallbackTexture, const float distance = 0.0f);
+
+    // Come draw, ma le mesh senza texture leggono il layer fallback dell'array sull'unita' TEXTURE_ARRAY_UNIT.
+    // Lo shader riceve il layer nell'uniform "layer", -1 per le mesh con una propria texture 2D
+    void drawLayered(const Model& model, const Shader& shader, const TextureLayer& fallback, const float distance = 0.0f);
+
+    // Chiamate di disegno dall'ultima lettura
+    unsigned int takeDrawCount();
+
+    virtual MemoryUsage memoryUsage() const override;
+
+    void clear();
+};
+
+MemoryUsage StaticGeometry::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& pair : _batches) {
+        for (const auto& batch : pair.second)
+            usage.cpuBytes += sizeof(StaticDrawBatch) + vectorBytes(batch.counts) + vectorBytes(batch.offsets) + vectorBytes(batch.baseVertices);
+    }
+    usage.cpuBytes += _bounds.size() * sizeof(CullBounds);
+    usage.gpuBytes = _VBO.bytes() + _EBO.bytes();
+    return usage;
+}
+
+void StaticGeometry::build(const std::vector<Model*>& models) {
+    if (isBuilt())
+        return;
+
+    std::vector<StaticVertex> vertices;
+    std::vector<unsigned int> indices;
+
+    for (auto model : models) {
+        std::vector<StaticDrawBatch>& batches = _batches[model];
+        _bounds[model] = CullBounds::fromModel(*model);
+        for (auto& mesh : model->meshes) {
+            unsigned int texture = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+            auto batch = std::find_if(batches.begin(), batches.end(), [texture](const StaticDrawBatch& b) { return b.texture == texture; });
+            if (batch == batches.end()) {
+                batches.push_back(StaticDrawBatch());
+                batch = batches.end() - 1;
+                batch->texture = texture;
+            }
+
+            batch->counts.push_back(static_cast<GLsizei>(mesh.indices.size()));
+            batch->offsets.push_back(reinterpret_cast<const void*>(indices.size() * sizeof(unsigned int)));
+            batch->baseVertices.push_back(static_cast<GLint>(vertices.size()));
+
+            for (const auto& vertex : mesh.vertices)
+                vertices.push_back({ vertex.Position, vertex.Normal, vertex.TexCoords });
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+            mesh.releaseBuffers();
+        }
+    }
+
+    _VAO = GLVertexArray::create();
+    _VBO = GLBuffer::create();
+    _EBO = GLBuffer::create();
+
+    glBindVertexArray(_VAO.id());
+    glBindBuffer(GL_ARRAY_BUFFER, _VBO.id());
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(StaticVertex), vertices.data(), GL_STATIC_DRAW);
+    _VBO.setBytes(vertices.size() * sizeof(StaticVertex));
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO.id());
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    _EBO.setBytes(indices.size() * sizeof(unsigned int));
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, texCoords));
+
+    glBindVertexArray(0);
+}
+
+void StaticGeometry::draw(const Model& model, const unsigned int fallbackTexture, const float distance) {
+    auto it = _batches.find(&model);
+    if (it == _batches.end())
+        return;
+
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    for (const auto& batch : it->second) {
+        unsigned int texture = batch.texture != 0 ? batch.texture : fallbackTexture;
+        stateCache.bindTexture(0, texture);
+        TextureStreamer::getInstance().touch(texture, distance);
+        _drawBatch(batch);
+    }
+}
+
+void StaticGeometry::drawLayered(const Model& model, const Shader& shader, const TextureLayer& fallback, const float distance) {
+    auto it = _batches.find(&model);
+    if (it == _batches.end())
+        return;
+
+    GLStateCache& stateCache = GLStateCache::getInstance();
+    for (const auto& batch : it->second) {
+        if (batch.texture != 0) {
+            shader.setFloat("layer", -1.0f);
+            stateCache.bindTexture(0, batch.texture);
+            TextureStreamer::getInstance().touch(batch.texture, distance);
+        }
+        else {
+            shader.setFloat("layer", static_cast<float>(fallback.layer));
+            stateCache.bindTextureArray(TEXTURE_ARRAY_UNIT, fallback.array);
+        }
+        _drawBatch(batch);
+    }
+}
+
+void StaticGeometry::_drawBatch(const StaticDrawBatch& batch) {
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, batch.counts.data(), GL_UNSIGNED_INT, batch.offsets.data(), static_cast<GLsizei>(batch.counts.size()), const_cast<GLint*>(batch.baseVertices.data()));
+    _draws++;
+}
+
+unsigned int StaticGeometry::takeDrawCount() {
+    unsigned int draws = _draws;
+    _draws = 0;
+    return draws;
+}
+
+void StaticGeometry::clear() {
+    _batches.clear();
+    _bounds.clear();
+    _EBO.reset();
+    _VBO.reset();
+    _VAO.reset();
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "constants.h"
+#include "gl_resource.h"
+#include "memory_stats.h"
+
+struct StreamingStats {
+    size_t bytes = 0;                   // byte scritti nel frame
+    unsigned int allocations = 0;
+    unsigned int stalls = 0;            // attese su un fence di una regione non ancora libera
+    unsigned int orphans = 0;           // regione piena: il buffer viene riallocato dal driver
+};
+
+// Buffer di vertici diviso in STREAMING_BUFFER_FRAMES regioni, una per frame: i dati dinamici del frame
+// (testo, AABB di debug, istanze visibili) vengono accodati nella regione corrente e un fence la protegge
+// finche' la GPU non l'ha consumata. Le scritture mappano il solo intervallo nuovo senza sincronizzazione:
+// il driver non attende mai l'uso precedente del buffer. Se una regione si riempie il buffer viene orfanato
+// e l'anello riparte da capo. Il nome del buffer non cambia mai, i VAO lo referenziano una volta sola
+class StreamingBuffer : public MemoryReporter {
+private:
+    StreamingBuffer() { MemoryStats::getInstance().add("streaming buffer", this); }
+
+    GLBuffer _buffer;
+    size_t _regionSize = STREAMING_BUFFER_REGION_SIZE;
+    GLsync _fences[STREAMING_BUFFER_FRAMES] = {};
+    unsigned int _region = 0;
+    size_t _head = 0;
+
+    StreamingStats _currentStats;
+    StreamingStats _lastFrameStats;
+
+    void _init();
+    void _waitForRegion(const unsigned int region);
+    // Nuovo storage per tutte le regioni, i fence in sospeso non servono piu'
+    void _orphan(const size_t regionSize);
+
+public:
+    StreamingBuffer(StreamingBuffer const&) = delete;
+    void operator=(StreamingBuffer const&) = delete;
+
+    static StreamingBuffer& getInstance() {
+        static StreamingBuffer instance;
+        return instance;
+    }
+
+    // Buffer da collegare ai VAO come sorgente degli attributi
+    unsigned int buffer();
+
+    // All'inizio del frame: passa alla regione successiva, attendendo la GPU solo se la sta ancora leggendo
+    void beginFrame();
+
+    // Dopo l'ultimo draw del frame
+    void endFrame();
+
+    // Copia i dati nella regione corrente e restituisce l'offset in byte, multiplo di alignment (ad es. lo
+    // stride dei vertici, cosi' il primo vertice del draw e' offset / stride). Lascia il buffer legato a GL_ARRAY_BUFFER
+    size_t upload(const void* data, const size_t bytes, const size_t alignment);
+
+    inline const StreamingStats& lastFrameStats() const { return _lastFrameStats; }
+
+    virtual MemoryUsage memoryUsage() const override;
+
+    void destroy();
+};
+
+MemoryUsage StreamingBuffer::memoryUsage() const {
+    MemoryUsage usage;
+    usage.gpuBytes = _buffer.bytes();
+    return usage;
+}
+
+void StreamingBuffer::_init() {
+    _buffer = GLBuffer::create();
+    glBindBuffer(GL_ARRAY_BUFFER, _buffer.id());
+    _orphan(_regionSize);
+}
+
+void StreamingBuffer::_orphan(const size_t regionSize) {
+    _regionSize = regionSize;
+    glBufferData(GL_ARRAY_BUFFER, _regionSize * STREAMING_BUFFER_FRAMES, NULL, GL_STREAM_DRAW);
+    _buffer.setBytes(_regionSize * STREAMING_BUFFER_FRAMES);
+
+    for (auto& fence : _fences) {
+        if (fence != 0)
+            glDeleteSync(fence);
+        fence = 0;
+    }
+    _region = 0;
+    _head = 0;
+}
+
+void StreamingBuffer::_waitForRegion(const unsigned int region) {
+    GLsync fence = _fences[region];
+    if (fence == 0)
+        return;
+
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        _currentStats.stalls++;
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+
+    glDeleteSync(fence);
+    _fences[region] = 0;
+}
+
+unsigned int StreamingBuffer::buffer() {
+    if (!_buffer)
+        _init();
+    return _buffer.id();
+}
+
+void StreamingBuffer::beginFrame() {
+    if (!_buffer)
+        return;
+
+    _lastFrameStats = _currentStats;
+    _currentStats = StreamingStats();
+
+    _region = (_region + 1) % STREAMING_BUFFER_FRAMES;
+    _head = 0;
+    _waitForRegion(_region);
+}
+
+void StreamingBuffer::endFrame() {
+    if (!_buffer || _head == 0)
+        return;
+
+    if (_fences[_region] != 0)
+        glDeleteSync(_fences[_region]);
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t StreamingBuffer::upload(const void* data, const size_t bytes, const size_t alignment) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer());
+
+    // L'allineamento vale sull'offset assoluto, le regioni non sono multiple dello stride
+    size_t base = _region * _regionSize;
+    size_t start = (base + _head + alignment - 1) / alignment * alignment;
+    if (start + bytes > base + _regionSize) {
+        // Un solo blocco piu' grande della regione la fa crescere per tutti i frame successivi
+        size_t regionSize = _regionSize;
+        while (bytes > regionSize)
+            regionSize *= 2;
+        _orphan(regionSize);
+        _currentStats.orphans++;
+        base = 0;
+        start = 0;
+    }
+
+    void* mapped = glMapBufferRange(GL_ARRAY_BUFFER, start, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped != nullptr) {
+        memcpy(mapped, data, bytes);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else {
+        glBufferSubData(GL_ARRAY_BUFFER, start, bytes, data);
+    }
+
+    _head = start + bytes - base;
+    _currentStats.bytes += bytes;
+    _currentStats.allocations++;
+    return start;
+}
+
+void StreamingBuffer::destroy() {
+    for (auto& fence : _fences) {
+        if (fence != 0)
+            glDeleteSync(fence);
+        fence = 0;
+    }
+    _buffer.reset();
+    _regionSize = STREAMING_BUFFER_REGION_SIZE;
+    _region = 0;
+    _head = 0;
+}
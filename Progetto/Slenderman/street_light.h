@@ -3,6 +3,7 @@
 #include "constants.h"
 #include "light_utils.h"
 #include "model_cache.h"
+#include "render_queue.h"
 #include "renderable.h"
 #include "shader_cache.h"
 #include "texture_cache.h"
@@ -13,7 +14,9 @@ public:
 
     inline aabb* toAABB() const;
 
-    virtual void render(const Camera& camera, const LightUtils& lightUtils) override;
+    virtual void submit(RenderQueue& queue, const Camera& camera) override;
+
+    virtual void draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) override;
 };
 
 StreetLight::StreetLight(glm::mat4 transform) {
@@ -22,23 +25,30 @@ StreetLight::StreetLight(glm::mat4 transform) {
     _texture = TextureCache::getInstance().findTexture(ETexture::streetLight);
 
     _transform = transform;
+    _normalMatrix = _normalMatrixOf(_transform);
 }
 
 aabb* StreetLight::toAABB() const {
     return aabb::fromModel(*(_model), _transform);
 }
 
-void StreetLight::render(const Camera& camera, const LightUtils& lightUtils) {
-    lightUtils.initLightShader(_shader, camera);
-
-    _shader->use();
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, _texture);
+void StreetLight::submit(RenderQueue& queue, const Camera& camera) {
+    if (!_isVisible())
+        return;
+
+    DrawPacket packet;
+    packet.pass = ERenderPass::opaque;
+    packet.owner = this;
+    packet.shader = _shader;
+    packet.texture = _texture;
+    packet.VAO = StaticGeometry::getInstance().VAO();
+    packet.usesLights = true;
+    packet.distance = _distanceFrom(camera);
+    queue.submit(packet);
+}
 
-    _shader->setMat4("view", camera.GetViewMatrix());
-    _shader->setMat4("projection", camera.GetProjection());
+void StreetLight::draw(const DrawPacket& packet, const Camera& camera, const LightUtils& lightUtils) {
     _shader->setMat4("model", _transform);
-
-    _model->Draw(*_shader);
+    _shader->setMat3("normalMatrix", _normalMatrix);
+    _drawModel(packet.distance);
 }
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <glad/glad.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "gl_resource.h"
+#include "memory_stats.h"
+#include "texture_upload_queue.h"
+
 enum class ETexture {
     slenderMan,
     floor,
@@ -37,13 +45,29 @@ enum class ETexture {
     winImage,
 };
 
-class TextureCache {
+// Texture impacchettate come layer di un GL_TEXTURE_2D_ARRAY: gli oggetti che le usano condividono un solo bind
+enum class ETextureArray {
+    poi,
+    page
+};
+
+// Unita' su cui la coda di rendering binda gli array, l'unita' 0 resta alle texture 2D
+const unsigned int TEXTURE_ARRAY_UNIT = 1;
+
+struct TextureLayer {
+    unsigned int array = 0;
+    int layer = -1;
+};
+
+class TextureCache : public MemoryReporter {
 private:
-    std::map<ETexture, unsigned int> _textureCache;
+    std::map<ETexture, GLTexture> _textureCache;
+    std::map<ETextureArray, GLTexture> _textureArrays;
+    std::map<ETexture, TextureLayer> _textureLayers;
 
     unsigned int _loadTexture(char const* path);
 
-    TextureCache() {}
+    TextureCache() { MemoryStats::getInstance().add("textures", this); }
 
 public:
     TextureCache(TextureCache const&) = delete;
@@ -51,13 +75,24 @@ public:
 
     static TextureCache& getInstance();
 
-    void registerTexture(ETexture key, const char* path);
+    // Se async la texture contiene un segnaposto finche' TextureUploadQueue non la carica
+    void registerTexture(ETexture key, const char* path, const bool async = true);
 
     unsigned int findTexture(ETexture key);
 
+    // Le immagini vengono caricate come layer di un array da TextureUploadQueue (vedi enqueueArray),
+    // i layer contengono un segnaposto fino al loro arrivo
+    void registerTextureArray(ETextureArray key, const std::vector<std::pair<ETexture, std::string>>& layers);
+
+    unsigned int findTextureArray(ETextureArray key);
+
+    TextureLayer findLayer(ETexture key) const;
+
     void clear();
 
-    inline bool has(ETexture key) const { return _textureCache.find(key) != _textureCache.end(); }
+    inline bool has(ETexture key) const { return _textureCache.find(key) != _textureCache.end() || _textureLayers.find(key) != _textureLayers.end(); }
+
+    virtual MemoryUsage memoryUsage() const override;
 
 };
 
@@ -66,25 +101,67 @@ TextureCache& TextureCache::getInstance() {
     return instance;
 }
 
-void TextureCache::registerTexture(ETexture key, const char* path) {
+MemoryUsage TextureCache::memoryUsage() const {
+    MemoryUsage usage;
+    usage.cpuBytes = (_textureCache.size() + _textureArrays.size()) * sizeof(GLTexture) + _textureLayers.size() * sizeof(TextureLayer);
+    for (const auto& pair : _textureCache)
+        usage.gpuBytes += pair.second.bytes();
+    for (const auto& pair : _textureArrays)
+        usage.gpuBytes += pair.second.bytes();
+    return usage;
+}
+
+void TextureCache::registerTexture(ETexture key, const char* path, const bool async) {
     if (_textureCache.find(key) != _textureCache.end())
         return;
 
-    unsigned int value = _loadTexture(path);
-    _textureCache[key] = value;
+    unsigned int value = async ? TextureUploadQueue::getInstance().enqueue(path) : _loadTexture(path);
+    _textureCache[key] = GLTexture(value);
 }
 
 unsigned int TextureCache::findTexture(ETexture key) {
-    return _textureCache[key];
+    return _textureCache[key].id();
+}
+
+void TextureCache::registerTextureArray(ETextureArray key, const std::vector<std::pair<ETexture, std::string>>& layers) {
+    if (_textureArrays.find(key) != _textureArrays.end() || layers.empty())
+        return;
+
+    std::vector<std::string> paths;
+    for (const auto& layer : layers)
+        paths.push_back(layer.second);
+    GLTexture textureArray = GLTexture(TextureUploadQueue::getInstance().enqueueArray(paths));
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        TextureLayer textureLayer;
+        textureLayer.array = textureArray.id();
+        textureLayer.layer = static_cast<int>(i);
+        _textureLayers[layers[i].first] = textureLayer;
+    }
+
+    _textureArrays[key] = std::move(textureArray);
+}
+
+unsigned int TextureCache::findTextureArray(ETextureArray key) {
+    return _textureArrays[key].id();
+}
+
+TextureLayer TextureCache::findLayer(ETexture key) const {
+    auto it = _textureLayers.find(key);
+    return it != _textureLayers.end() ? it->second : TextureLayer();
 }
 
+// Le texture vengono cancellate insieme alla cache
 void TextureCache::clear() {
+    _textureLayers.clear();
+    _textureArrays.clear();
     _textureCache.clear();
 }
 
 unsigned int TextureCache::_loadTexture(char const* path) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
+    GLResourceRegistry::getInstance().track(EGLResource::texture, textureID);
 
     int width, height, nrComponents;
     unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
@@ -100,6 +177,7 @@ unsigned int TextureCache::_loadTexture(char const* path) {
         glBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        GLResourceRegistry::getInstance().setBytes(EGLResource::texture, textureID, GLResourceRegistry::textureBytes(width, height, nrComponents, true));
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "constants.h"
+#include "gl_resource.h"
+#include "memory_stats.h"
+#include "texture_upload_ring.h"
+
+struct TextureMipLevel {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    inline size_t bytes() const { return pixels.size(); }
+};
+
+// Catena di mip calcolata sulla CPU (box filter 2x2) dal thread di decodifica
+struct TextureMipChain {
+    int components = 0;
+    std::vector<TextureMipLevel> levels;
+
+    static TextureMipChain build(const unsigned char* data, const int width, const int height, const int components);
+};
+
+struct TextureStreamingStats {
+    unsigned int textures = 0;
+    size_t residentBytes = 0;   // stimati: width * height * componenti per ogni livello residente
+    size_t fullBytes = 0;       // con tutte le catene complete
+    unsigned int uploadedLevels = 0;
+    unsigned int evictedLevels = 0;
+};
+
+struct StreamedTexture {
+    unsigned int textureID = 0;
+    GLenum format = GL_RGBA;
+    TextureMipChain mips;
+    int coarseLevel = 0;        // sempre residente
+    int residentLevel = 0;      // livello piu' fine residente
+    int wantedLevel = 0;        // livello piu' fine richiesto nel frame
+    unsigned long long lastTouched = 0;
+};
+
+// Streaming dei livelli di mip: all'arrivo di una texture si caricano solo i mip fino a TEXTURE_STREAMING_COARSE_SIZE,
+// i livelli piu' fini arrivano quando la texture viene usata (touch) abbastanza vicino alla camera.
+// Se la memoria stimata supera TEXTURE_STREAMING_BUDGET_BYTES si scartano i livelli fini delle texture usate meno di recente.
+// La catena completa resta in memoria di sistema, la VRAM contiene solo i livelli [residentLevel, ultimo].
+// I livelli passano da TextureUploadRing, nello stesso budget per frame dei caricamenti di TextureUploadQueue
+class TextureStreamer : public MemoryReporter {
+private:
+    TextureStreamer() { MemoryStats::getInstance().add("texture streaming", this); }
+
+    std::unordered_map<unsigned int, StreamedTexture> _textures;
+    std::vector<StreamedTexture*> _upgrades;
+    std::vector<StreamedTexture*> _evictable;
+    unsigned long long _frame = 1;
+    size_t _residentBytes = 0;
+    unsigned int _uploadedLevels = 0;
+    unsigned int _evictedLevels = 0;
+
+    // pixels e' l'offset nel PBO collegato oppure, senza PBO, il puntatore ai dati
+    void _defineLevel(StreamedTexture& texture, const int level, const void* pixels);
+    // False se nessun PBO e' libero: il livello verra' caricato in un frame successivo
+    bool _uploadLevel(StreamedTexture& texture, const int level, const bool wait = false);
+    void _evictLevel(StreamedTexture& texture);
+    bool _makeRoom(const size_t bytes);
+
+public:
+    TextureStreamer(TextureStreamer const&) = delete;
+    void operator=(TextureStreamer const&) = delete;
+
+    static TextureStreamer& getInstance() {
+        static TextureStreamer instance;
+        return instance;
+    }
+
+    // Prende in carico una texture decodificata e carica i suoi livelli grossolani
+    void adopt(const unsigned int textureID, const GLenum format, TextureMipChain& mips);
+
+    // Segnala l'uso della texture nel frame, distance e' la distanza dalla camera (0 per gli elementi a schermo)
+    void touch(const unsigned int textureID, const float distance = 0.0f);
+
+    // Carica tutti i livelli subito, per chi disegna una volta sola (bake degli impostor)
+    void makeResident(const unsigned int textureID);
+
+    // Da chiamare a fine frame: carica i livelli richiesti ed eventualmente libera memoria
+    void update();
+
+    TextureStreamingStats stats() const;
+
+    // Le catene di mip in memoria di sistema: la VRAM e' contata da chi possiede le texture
+    virtual MemoryUsage memoryUsage() const override;
+
+    void clear();
+};
+
+MemoryUsage TextureStreamer::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& pair : _textures) {
+        usage.cpuBytes += sizeof(StreamedTexture);
+        for (const auto& level : pair.second.mips.levels)
+            usage.cpuBytes += level.pixels.capacity();
+    }
+    usage.cpuBytes += vectorBytes(_upgrades) + vectorBytes(_evictable);
+    return usage;
+}
+
+TextureMipChain TextureMipChain::build(const unsigned char* data, const int width, const int height, const int components) {
+    TextureMipChain chain;
+    chain.components = components;
+
+    TextureMipLevel base;
+    base.width = width;
+    base.height = height;
+    base.pixels.assign(data, data + static_cast<size_t>(width) * height * components);
+    chain.levels.push_back(std::move(base));
+
+    while (chain.levels.back().width > 1 || chain.levels.back().height > 1) {
+        const TextureMipLevel& source = chain.levels.back();
+        TextureMipLevel level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * components);
+
+        for (int y = 0; y < level.height; y++) {
+            int y0 = std::min(y * 2, source.height - 1);
+            int y1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; x++) {
+                int x0 = std::min(x * 2, source.width - 1);
+                int x1 = std::min(x * 2 + 1, source.width - 1);
+                for (int c = 0; c < components; c++) {
+                    int sum = source.pixels[(static_cast<size_t>(y0) * source.width + x0) * components + c]
+                        + source.pixels[(static_cast<size_t>(y0) * source.width + x1) * components + c]
+                        + source.pixels[(static_cast<size_t>(y1) * source.width + x0) * components + c]
+                        + source.pixels[(static_cast<size_t>(y1) * source.width + x1) * components + c];
+                    level.pixels[(static_cast<size_t>(y) * level.width + x) * components + c] = static_cast<unsigned char>((sum + 2) / 4);
+                }
+            }
+        }
+        chain.levels.push_back(std::move(level));
+    }
+
+    return chain;
+}
+
+void TextureStreamer::_defineLevel(StreamedTexture& texture, const int level, const void* pixels) {
+    const TextureMipLevel& mip = texture.mips.levels[level];
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glTexImage2D(GL_TEXTURE_2D, level, texture.format, mip.width, mip.height, 0, texture.format, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.residentLevel = level;
+    _residentBytes += mip.bytes();
+    GLResourceRegistry::getInstance().addBytes(EGLResource::texture, texture.textureID, static_cast<long long>(mip.bytes()));
+    _uploadedLevels++;
+}
+
+bool TextureStreamer::_uploadLevel(StreamedTexture& texture, const int level, const bool wait) {
+    const TextureMipLevel& mip = texture.mips.levels[level];
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    if (!ring.stage(mip.pixels.data(), mip.bytes(), wait))
+        return false;
+
+    _defineLevel(texture, level, (void*)0);
+    ring.release(mip.bytes());
+    return true;
+}
+
+void TextureStreamer::_evictLevel(StreamedTexture& texture) {
+    int level = texture.residentLevel;
+
+    // Un livello di dimensione zero libera la memoria, il livello base esclude comunque i livelli scartati
+    glBindTexture(GL_TEXTURE_2D, texture.textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    glTexImage2D(GL_TEXTURE_2D, level, texture.format, 0, 0, 0, texture.format, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    texture.residentLevel = level + 1;
+    _residentBytes -= texture.mips.levels[level].bytes();
+    GLResourceRegistry::getInstance().addBytes(EGLResource::texture, texture.textureID, -static_cast<long long>(texture.mips.levels[level].bytes()));
+    _evictedLevels++;
+}
+
+bool TextureStreamer::_makeRoom(const size_t bytes) {
+    if (_residentBytes + bytes <= TEXTURE_STREAMING_BUDGET_BYTES)
+        return true;
+
+    // Si scartano prima i livelli delle texture non usate nel frame, dalla meno recente
+    _evictable.clear();
+    for (auto& entry : _textures) {
+        StreamedTexture& texture = entry.second;
+        if (texture.lastTouched < _frame && texture.residentLevel < texture.coarseLevel)
+            _evictable.push_back(&texture);
+    }
+    std::sort(_evictable.begin(), _evictable.end(), [](const StreamedTexture* a, const StreamedTexture* b) { return a->lastTouched < b->lastTouched; });
+
+    for (auto texture : _evictable) {
+        while (texture->residentLevel < texture->coarseLevel && _residentBytes + bytes > TEXTURE_STREAMING_BUDGET_BYTES)
+            _evictLevel(*texture);
+        if (_residentBytes + bytes <= TEXTURE_STREAMING_BUDGET_BYTES)
+            return true;
+    }
+    return false;
+}
+
+void TextureStreamer::adopt(const unsigned int textureID, const GLenum format, TextureMipChain& mips) {
+    StreamedTexture& texture = _textures[textureID];
+    texture.textureID = textureID;
+    texture.format = format;
+    texture.mips = std::move(mips);
+
+    int lastLevel = static_cast<int>(texture.mips.levels.size()) - 1;
+    texture.coarseLevel = lastLevel;
+    for (int level = 0; level <= lastLevel; level++) {
+        const TextureMipLevel& mip = texture.mips.levels[level];
+        if (std::max(mip.width, mip.height) <= TEXTURE_STREAMING_COARSE_SIZE) {
+            texture.coarseLevel = level;
+            break;
+        }
+    }
+    texture.wantedLevel = texture.coarseLevel;
+
+    // Il segnaposto occupa il livello 0: va sostituito prima di definire la catena a partire dal livello grossolano
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, NULL);
+    GLResourceRegistry::getInstance().setBytes(EGLResource::texture, textureID, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, lastLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // I livelli grossolani sono piccoli: viaggiano tutti nello stesso PBO, gia' liberato da TextureUploadQueue
+    size_t bytes = 0;
+    for (int level = lastLevel; level >= texture.coarseLevel; level--)
+        bytes += texture.mips.levels[level].bytes();
+
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    unsigned char* mapped = ring.map(bytes, true);
+    bool staged = false;
+    if (mapped != nullptr) {
+        size_t offset = 0;
+        for (int level = lastLevel; level >= texture.coarseLevel; level--) {
+            memcpy(mapped + offset, texture.mips.levels[level].pixels.data(), texture.mips.levels[level].bytes());
+            offset += texture.mips.levels[level].bytes();
+        }
+        staged = ring.unmap();
+    }
+
+    // Dal piu' piccolo al piu' grande, cosi' il livello base resta sempre quello appena caricato.
+    // Se il PBO non e' disponibile i livelli vengono copiati direttamente dalla memoria di sistema
+    size_t offset = 0;
+    for (int level = lastLevel; level >= texture.coarseLevel; level--) {
+        const TextureMipLevel& mip = texture.mips.levels[level];
+        _defineLevel(texture, level, staged ? (const void*)offset : mip.pixels.data());
+        offset += mip.bytes();
+    }
+
+    if (staged)
+        ring.release(bytes);
+}
+
+void TextureStreamer::touch(const unsigned int textureID, const float distance) {
+    auto it = _textures.find(textureID);
+    if (it == _textures.end())
+        return;
+
+    StreamedTexture& texture = it->second;
+    if (texture.lastTouched != _frame) {
+        texture.lastTouched = _frame;
+        texture.wantedLevel = texture.coarseLevel;
+    }
+
+    // Un livello di mip in meno ogni volta che la distanza raddoppia oltre TEXTURE_STREAMING_DETAIL_DISTANCE
+    int level = 0;
+    if (distance > TEXTURE_STREAMING_DETAIL_DISTANCE)
+        level = static_cast<int>(log2(distance / TEXTURE_STREAMING_DETAIL_DISTANCE));
+    texture.wantedLevel = std::min(texture.wantedLevel, level);
+}
+
+void TextureStreamer::makeResident(const unsigned int textureID) {
+    auto it = _textures.find(textureID);
+    if (it == _textures.end())
+        return;
+
+    StreamedTexture& texture = it->second;
+    texture.lastTouched = _frame;
+    // Qui si puo' attendere che un PBO si liberi; se il PBO non si puo' mappare il livello arriva dalla memoria di sistema
+    while (texture.residentLevel > 0) {
+        int level = texture.residentLevel - 1;
+        if (!_uploadLevel(texture, level, true))
+            _defineLevel(texture, level, texture.mips.levels[level].pixels.data());
+    }
+}
+
+void TextureStreamer::update() {
+    _upgrades.clear();
+    for (auto& entry : _textures) {
+        StreamedTexture& texture = entry.second;
+        if (texture.lastTouched == _frame && texture.wantedLevel < texture.residentLevel)
+            _upgrades.push_back(&texture);
+    }
+
+    // Prima le texture piu' lontane dal livello richiesto
+    std::sort(_upgrades.begin(), _upgrades.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+        return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel;
+    });
+
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    for (auto texture : _upgrades) {
+        // Un livello per texture per frame, il dettaglio aumenta progressivamente
+        int level = texture->residentLevel - 1;
+        size_t bytes = texture->mips.levels[level].bytes();
+        if (!ring.hasBudget(bytes) || !ring.acquire())
+            break;
+        if (!_makeRoom(bytes))
+            break;
+        if (!_uploadLevel(*texture, level))
+            break;
+    }
+
+    _frame++;
+}
+
+TextureStreamingStats TextureStreamer::stats() const {
+    TextureStreamingStats stats;
+    stats.textures = static_cast<unsigned int>(_textures.size());
+    stats.residentBytes = _residentBytes;
+    for (const auto& entry : _textures)
+        for (const auto& level : entry.second.mips.levels)
+            stats.fullBytes += level.bytes();
+    stats.uploadedLevels = _uploadedLevels;
+    stats.evictedLevels = _evictedLevels;
+    return stats;
+}
+
+void TextureStreamer::clear() {
+    _textures.clear();
+    _upgrades.clear();
+    _evictable.clear();
+    _residentBytes = 0;
+}
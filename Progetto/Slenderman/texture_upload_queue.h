@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "constants.h"
+#include "gl_resource.h"
+#include "stb_image.h"
+#include "texture_streamer.h"
+#include "texture_upload_ring.h"
+
+struct TextureUploadRequest {
+    unsigned int textureID;
+    std::string path;
+    // Se non vuoto la texture e' un GL_TEXTURE_2D_ARRAY con un layer per immagine
+    std::vector<std::string> layerPaths;
+};
+
+struct DecodedTexture {
+    unsigned int textureID = 0;
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    unsigned char* data = nullptr;
+    // Con lo streaming attivo il thread di decodifica prepara anche la catena di mip
+    TextureMipChain mips;
+    // Layer di un array (-1 per le texture 2D): i pixel ricampionati al lato comune stanno in pixels
+    int layer = -1;
+    int layers = 0;
+    std::vector<unsigned char> pixels;
+
+    inline size_t bytes() const { return static_cast<size_t>(width) * height * components; }
+
+    inline const unsigned char* pixelData() const { return data != nullptr ? data : pixels.data(); }
+
+    inline bool loaded() const { return data != nullptr || !pixels.empty(); }
+};
+
+// Caricamento asincrono delle texture: enqueue restituisce subito un handle GL valido che contiene un texel
+// segnaposto, un thread decodifica l'immagine e process() la carica sul thread GL attraverso TextureUploadRing,
+// rispettando il budget di byte del frame. L'handle non cambia mai, quindi chi lo ha gia' letto vede la texture
+// definitiva non appena e' pronta
+class TextureUploadQueue {
+private:
+    TextureUploadQueue() {}
+
+    std::thread _worker;
+    bool _running = false;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<TextureUploadRequest> _requests;
+    std::deque<DecodedTexture> _decoded;
+    unsigned int _pending = 0;
+
+    void _run();
+    void _startWorker();
+    void _decodeArray(const TextureUploadRequest& request, std::vector<DecodedTexture>& layers);
+    void _upload(DecodedTexture& texture);
+    void _uploadLayer(DecodedTexture& texture);
+
+    // Ricampionamento bilineare
+    static std::vector<unsigned char> _resize(const unsigned char* data, const int width, const int height, const int components, const int newWidth, const int newHeight);
+
+public:
+    TextureUploadQueue(TextureUploadQueue const&) = delete;
+    void operator=(TextureUploadQueue const&) = delete;
+
+    static TextureUploadQueue& getInstance() {
+        static TextureUploadQueue instance;
+        return instance;
+    }
+
+    // Crea la texture con il segnaposto e ne accoda il caricamento
+    unsigned int enqueue(const std::string& path);
+
+    // Come enqueue per un array RGB8 con un layer per immagine. Il lato dei layer e' il massimo tra le immagini
+    // (entro TEXTURE_ARRAY_MAX_SIZE), le immagini di dimensioni diverse vengono ricampionate dal thread di decodifica
+    unsigned int enqueueArray(const std::vector<std::string>& paths);
+
+    // Carica le texture decodificate finche' i byte caricati nel frame restano sotto il budget (almeno una per chiamata)
+    void process(const size_t byteBudget = TEXTURE_UPLOAD_BUDGET_BYTES);
+
+    // Attende e carica tutte le texture in coda
+    void finish();
+
+    unsigned int pending();
+
+    void destroy();
+};
+
+unsigned int TextureUploadQueue::enqueue(const std::string& path) {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    const unsigned char placeholder[4] = { 128, 128, 128, 255 };
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+    // Registrata qui, chi riceve l'handle ne prende la proprieta' con un GLTexture
+    GLResourceRegistry::getInstance().track(EGLResource::texture, textureID);
+    GLResourceRegistry::getInstance().setBytes(EGLResource::texture, textureID, sizeof(placeholder));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    _startWorker();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back({ textureID, path, {} });
+        _pending++;
+    }
+    _condition.notify_all();
+
+    return textureID;
+}
+
+unsigned int TextureUploadQueue::enqueueArray(const std::vector<std::string>& paths) {
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    const GLsizei layers = static_cast<GLsizei>(paths.size());
+    const std::vector<unsigned char> placeholder(static_cast<size_t>(layers) * 3, 128);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, 1, 1, layers, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder.data());
+    GLResourceRegistry::getInstance().track(EGLResource::texture, textureID);
+    GLResourceRegistry::getInstance().setBytes(EGLResource::texture, textureID, placeholder.size());
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    _startWorker();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _requests.push_back({ textureID, std::string(), paths });
+        // Ogni layer arriva a process come una texture a se'
+        _pending += static_cast<unsigned int>(layers);
+    }
+    _condition.notify_all();
+
+    return textureID;
+}
+
+void TextureUploadQueue::_startWorker() {
+    if (_running)
+        return;
+
+    _running = true;
+    _worker = std::thread(&TextureUploadQueue::_run, this);
+}
+
+void TextureUploadQueue::_run() {
+    while (true) {
+        TextureUploadRequest request;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return !_running || !_requests.empty(); });
+            if (!_running)
+                return;
+            request = _requests.front();
+            _requests.pop_front();
+        }
+
+        std::vector<DecodedTexture> decoded;
+        if (!request.layerPaths.empty()) {
+            _decodeArray(request, decoded);
+        }
+        else {
+            DecodedTexture texture;
+            texture.textureID = request.textureID;
+            texture.path = request.path;
+            texture.data = stbi_load(request.path.c_str(), &texture.width, &texture.height, &texture.components, 0);
+            if (USE_TEXTURE_STREAMING && texture.data != nullptr)
+                texture.mips = TextureMipChain::build(texture.data, texture.width, texture.height, texture.components);
+            decoded.push_back(std::move(texture));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto& texture : decoded)
+                _decoded.push_back(std::move(texture));
+        }
+        _condition.notify_all();
+    }
+}
+
+void TextureUploadQueue::_decodeArray(const TextureUploadRequest& request, std::vector<DecodedTexture>& layers) {
+    const int components = 3;
+    int width = 1, height = 1;
+    for (const auto& path : request.layerPaths) {
+        DecodedTexture layer;
+        layer.textureID = request.textureID;
+        layer.path = path;
+        layer.layer = static_cast<int>(layers.size());
+        layer.layers = static_cast<int>(request.layerPaths.size());
+        layer.data = stbi_load(path.c_str(), &layer.width, &layer.height, &layer.components, components);
+        if (layer.data == nullptr)
+            std::cout << "ERROR::TEXTURE:: Failed to load " << path << std::endl;
+        width = std::max(width, layer.width);
+        height = std::max(height, layer.height);
+        layers.push_back(std::move(layer));
+    }
+    width = std::min(width, TEXTURE_ARRAY_MAX_SIZE);
+    height = std::min(height, TEXTURE_ARRAY_MAX_SIZE);
+
+    for (auto& layer : layers) {
+        // Un'immagine mancante lascia il layer nero
+        if (layer.data == nullptr) {
+            layer.pixels.assign(static_cast<size_t>(width) * height * components, 0);
+        }
+        else if (layer.width != width || layer.height != height) {
+            layer.pixels = _resize(layer.data, layer.width, layer.height, components, width, height);
+            stbi_image_free(layer.data);
+            layer.data = nullptr;
+        }
+        layer.width = width;
+        layer.height = height;
+        layer.components = components;
+    }
+}
+
+std::vector<unsigned char> TextureUploadQueue::_resize(const unsigned char* data, const int width, const int height, const int components, const int newWidth, const int newHeight) {
+    std::vector<unsigned char> resized(static_cast<size_t>(newWidth) * newHeight * components);
+    float scaleX = static_cast<float>(width) / newWidth;
+    float scaleY = static_cast<float>(height) / newHeight;
+
+    for (int y = 0; y < newHeight; y++) {
+        // Centro del texel di destinazione nelle coordinate della sorgente
+        float sourceY = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+        int y0 = std::min(static_cast<int>(sourceY), height - 1);
+        int y1 = std::min(y0 + 1, height - 1);
+        float fy = sourceY - y0;
+
+        for (int x = 0; x < newWidth; x++) {
+            float sourceX = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+            int x0 = std::min(static_cast<int>(sourceX), width - 1);
+            int x1 = std::min(x0 + 1, width - 1);
+            float fx = sourceX - x0;
+
+            for (int c = 0; c < components; c++) {
+                float top = data[(y0 * width + x0) * components + c] * (1.0f - fx) + data[(y0 * width + x1) * components + c] * fx;
+                float bottom = data[(y1 * width + x0) * components + c] * (1.0f - fx) + data[(y1 * width + x1) * components + c] * fx;
+                resized[(static_cast<size_t>(y) * newWidth + x) * components + c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    return resized;
+}
+
+void TextureUploadQueue::_upload(DecodedTexture& texture) {
+    if (texture.layer >= 0) {
+        _uploadLayer(texture);
+        return;
+    }
+
+    GLenum format;
+    if (texture.components == 1)
+        format = GL_RED;
+    else if (texture.components == 3)
+        format = GL_RGB;
+    else if (texture.components == 4)
+        format = GL_RGBA;
+    else {
+        std::cout << "Texture format not supported: " << texture.path << std::endl;
+        return;
+    }
+
+    // I livelli fini arrivano poi dallo streamer in base all'uso
+    if (!texture.mips.levels.empty()) {
+        TextureStreamer::getInstance().adopt(texture.textureID, format, texture.mips);
+        return;
+    }
+
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    if (ring.stage(texture.data, texture.bytes())) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, texture.textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, texture.width, texture.height, 0, format, GL_UNSIGNED_BYTE, (void*)0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        GLResourceRegistry::getInstance().setBytes(EGLResource::texture, texture.textureID, GLResourceRegistry::textureBytes(texture.width, texture.height, texture.components, true));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        ring.release(texture.bytes());
+    }
+}
+
+void TextureUploadQueue::_uploadLayer(DecodedTexture& texture) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture.textureID);
+
+    // Il primo layer sostituisce il segnaposto con lo storage definitivo, prima di collegare il PBO
+    if (texture.layer == 0) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB8, texture.width, texture.height, texture.layers, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        GLResourceRegistry::getInstance().setBytes(EGLResource::texture, texture.textureID, GLResourceRegistry::textureBytes(texture.width, texture.height, texture.components, true) * texture.layers);
+    }
+
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (ring.stage(texture.pixelData(), texture.bytes())) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, texture.layer, texture.width, texture.height, 1, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+        ring.release(texture.bytes());
+    }
+    else {
+        // Il layer non puo' essere perso: senza PBO si copia direttamente dalla memoria di sistema
+        std::cout << "Texture layer upload failed, copying without PBO: " << texture.path << std::endl;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, texture.layer, texture.width, texture.height, 1, GL_RGB, GL_UNSIGNED_BYTE, texture.pixelData());
+    }
+
+    // La catena di mip dell'array si genera quando e' arrivato l'ultimo layer
+    if (texture.layer == texture.layers - 1) {
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void TextureUploadQueue::process(const size_t byteBudget) {
+    TextureUploadRing& ring = TextureUploadRing::getInstance();
+    unsigned int uploaded = 0;
+
+    while (uploaded == 0 || ring.frameBytes() < byteBudget) {
+        // Il thread di decodifica aggiunge solo in coda: il primo elemento resta lo stesso fino al pop
+        bool loaded;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_decoded.empty())
+                return;
+            loaded = _decoded.front().loaded();
+        }
+
+        if (loaded && !ring.acquire())
+            return;
+
+        DecodedTexture texture;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            texture = std::move(_decoded.front());
+            _decoded.pop_front();
+            _pending--;
+        }
+
+        if (!texture.loaded()) {
+            std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+            continue;
+        }
+
+        // I byte caricati vengono contati dall'anello di PBO, con lo streaming solo i mip grossolani
+        _upload(texture);
+        uploaded++;
+        stbi_image_free(texture.data);
+    }
+}
+
+void TextureUploadQueue::finish() {
+    while (pending() > 0) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return !_decoded.empty() || _pending == 0; });
+        }
+        process(SIZE_MAX);
+
+        // Tutti i PBO occupati: qui si puo' attendere la GPU
+        TextureUploadRing::getInstance().acquire(true);
+    }
+}
+
+unsigned int TextureUploadQueue::pending() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _pending;
+}
+
+void TextureUploadQueue::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+        _requests.clear();
+    }
+    _condition.notify_all();
+    if (_worker.joinable())
+        _worker.join();
+
+    for (auto& texture : _decoded)
+        stbi_image_free(texture.data);
+    _decoded.clear();
+    _pending = 0;
+}
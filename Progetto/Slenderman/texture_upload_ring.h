@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "constants.h"
+#include "gl_resource.h"
+#include "memory_stats.h"
+
+// Anello di PBO usato da tutti i caricamenti di texture (TextureUploadQueue e TextureStreamer): la copia dal PBO
+// alla texture e' asincrona e un fence protegge ogni PBO finche' la GPU non l'ha letto.
+// I byte caricati nel frame rientrano in un solo budget, TEXTURE_UPLOAD_BUDGET_BYTES
+class TextureUploadRing : public MemoryReporter {
+private:
+    TextureUploadRing() { MemoryStats::getInstance().add("texture uploads", this); }
+
+    GLBuffer _PBOs[TEXTURE_UPLOAD_PBOS];
+    size_t _PBOSizes[TEXTURE_UPLOAD_PBOS] = {};
+    GLsync _PBOFences[TEXTURE_UPLOAD_PBOS] = {};
+    unsigned int _PBOIndex = 0;
+
+    size_t _frameBytes = 0;
+
+public:
+    TextureUploadRing(TextureUploadRing const&) = delete;
+    void operator=(TextureUploadRing const&) = delete;
+
+    static TextureUploadRing& getInstance() {
+        static TextureUploadRing instance;
+        return instance;
+    }
+
+    // All'inizio del frame, prima di qualunque caricamento
+    inline void beginFrame() { _frameBytes = 0; }
+
+    inline size_t frameBytes() const { return _frameBytes; }
+
+    // Il primo caricamento del frame passa anche se piu' grande del budget
+    inline bool hasBudget(const size_t bytes) const { return _frameBytes == 0 || _frameBytes + bytes <= TEXTURE_UPLOAD_BUDGET_BYTES; }
+
+    // Vero se il PBO corrente e' libero. Senza wait non blocca: se la GPU lo sta ancora leggendo si riprova al frame successivo
+    bool acquire(const bool wait = false);
+
+    // Mappa il PBO corrente per bytes byte e lo lascia collegato a GL_PIXEL_UNPACK_BUFFER, nullptr se non e' disponibile.
+    // Con il PBO collegato l'ultimo argomento di glTexImage / glTexSubImage e' l'offset nel buffer
+    unsigned char* map(const size_t bytes, const bool wait = false);
+
+    // Copia i pixel nel PBO corrente: map e unmap in un passo
+    bool stage(const void* data, const size_t bytes, const bool wait = false);
+
+    // Da chiamare dopo map: false se il contenuto del PBO e' andato perso
+    bool unmap();
+
+    // Dopo le copie verso le texture: protegge il PBO con un fence, passa al successivo e scollega il buffer
+    void release(const size_t bytes);
+
+    virtual MemoryUsage memoryUsage() const override;
+
+    void destroy();
+};
+
+MemoryUsage TextureUploadRing::memoryUsage() const {
+    MemoryUsage usage;
+    for (const auto& PBO : _PBOs)
+        usage.gpuBytes += PBO.bytes();
+    return usage;
+}
+
+bool TextureUploadRing::acquire(const bool wait) {
+    GLsync fence = _PBOFences[_PBOIndex];
+    if (fence == 0)
+        return true;
+
+    if (wait)
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    else if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    glDeleteSync(fence);
+    _PBOFences[_PBOIndex] = 0;
+    return true;
+}
+
+unsigned char* TextureUploadRing::map(const size_t bytes, const bool wait) {
+    if (!acquire(wait))
+        return nullptr;
+
+    if (!_PBOs[0])
+        for (auto& PBO : _PBOs)
+            PBO = GLBuffer::create();
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _PBOs[_PBOIndex].id());
+    if (_PBOSizes[_PBOIndex] < bytes) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        _PBOSizes[_PBOIndex] = bytes;
+        _PBOs[_PBOIndex].setBytes(bytes);
+    }
+
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped == nullptr)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return static_cast<unsigned char*>(mapped);
+}
+
+bool TextureUploadRing::stage(const void* data, const size_t bytes, const bool wait) {
+    unsigned char* mapped = map(bytes, wait);
+    if (mapped == nullptr)
+        return false;
+
+    memcpy(mapped, data, bytes);
+    return unmap();
+}
+
+bool TextureUploadRing::unmap() {
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE)
+        return true;
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return false;
+}
+
+void TextureUploadRing::release(const size_t bytes) {
+    _PBOFences[_PBOIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _PBOIndex = (_PBOIndex + 1) % TEXTURE_UPLOAD_PBOS;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    _frameBytes += bytes;
+}
+
+void TextureUploadRing::destroy() {
+    for (unsigned int i = 0; i < TEXTURE_UPLOAD_PBOS; i++) {
+        if (_PBOFences[i] != 0)
+            glDeleteSync(_PBOFences[i]);
+        _PBOFences[i] = 0;
+        _PBOSizes[i] = 0;
+        _PBOs[i].reset();
+    }
+    _PBOIndex = 0;
+    _frameBytes = 0;
+}
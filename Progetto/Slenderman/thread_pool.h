@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "constants.h"
+
+// Pool di thread per lavori paralleli sui dati (generazione della mappa).
+// parallelFor distribuisce gli indici [0, count) tra i worker e il thread chiamante e ritorna quando sono tutti completati:
+// ogni indice deve scrivere solo nei propri dati, cosi' il risultato non dipende dal numero di thread
+class ThreadPool {
+private:
+    ThreadPool() {}
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _doneCondition;
+    bool _running = false;
+
+    // Lavoro corrente
+    const std::function<void(int)>* _task = nullptr;
+    int _count = 0;
+    unsigned long long _generation = 0;
+    std::atomic<int> _next{ 0 };
+    int _busyWorkers = 0;
+
+    void _start();
+    void _run();
+    void _drain(const std::function<void(int)>& task, const int count);
+
+public:
+    ThreadPool(ThreadPool const&) = delete;
+    void operator=(ThreadPool const&) = delete;
+
+    static ThreadPool& getInstance() {
+        static ThreadPool instance;
+        return instance;
+    }
+
+    void parallelFor(const int count, const std::function<void(int)>& task);
+
+    inline unsigned int threadCount() const { return static_cast<unsigned int>(_workers.size()) + 1; }
+
+    void destroy();
+};
+
+void ThreadPool::_start() {
+    if (_running)
+        return;
+
+    unsigned int threads = MAP_GENERATION_THREADS > 0 ? MAP_GENERATION_THREADS : std::thread::hardware_concurrency();
+    threads = std::max(1u, threads);
+
+    _running = true;
+    // Anche il thread chiamante lavora
+    for (unsigned int i = 1; i < threads; i++)
+        _workers.push_back(std::thread(&ThreadPool::_run, this));
+}
+
+void ThreadPool::_drain(const std::function<void(int)>& task, const int count) {
+    int index;
+    while ((index = _next.fetch_add(1)) < count)
+        task(index);
+}
+
+void ThreadPool::_run() {
+    unsigned long long generation = 0;
+    while (true) {
+        const std::function<void(int)>* task;
+        int count;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this, generation]() { return !_running || _generation != generation; });
+            if (!_running)
+                return;
+            generation = _generation;
+            // Svegliato dopo la fine del lavoro: gli indici sono gia' stati eseguiti dagli altri
+            if (_task == nullptr)
+                continue;
+            task = _task;
+            count = _count;
+            _busyWorkers++;
+        }
+
+        _drain(*task, count);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _busyWorkers--;
+        }
+        _doneCondition.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(const int count, const std::function<void(int)>& task) {
+    if (count <= 0)
+        return;
+
+    _start();
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _count = count;
+        _next = 0;
+        _generation++;
+    }
+    _condition.notify_all();
+
+    _drain(task, count);
+
+    // Gli indici sono esauriti ma qualche worker puo' essere ancora dentro al proprio task
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this]() { return _busyWorkers == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::destroy() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _running = false;
+    }
+    _condition.notify_all();
+
+    for (auto& worker : _workers)
+        if (worker.joinable())
+            worker.join();
+    _workers.clear();
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "aabb.h"
+#include "collision_solver.h"
+#include "constants.h"
+#include "dynamic_map_renderable.h"
+#include "fence.h"
+#include "floor.h"
+#include "impostor_renderable.h"
+#include "memory_stats.h"
+#include "minimap.h"
+#include "renderable.h"
+#include "texture_upload_queue.h"
+
+// Risorse del mondo che non dipendono dalla partita (terreno, erba, alberi con i loro impostor e AABB, recinzione, minimappa).
+// Vengono generate alla prima partita e sopravvivono alla GameScene: ai riavvii cambiano solo i chunk nascosti
+// dai POI e i marker della minimappa, come ModelCache/ShaderCache/TextureCache restano caldi tra una partita e l'altra
+class WorldCache : public MemoryReporter {
+private:
+    WorldCache() { MemoryStats::getInstance().add("world", this); }
+
+    bool _built = false;
+
+    DynamicMapRenderable* _forest = nullptr;
+    TreeImpostorRenderable* _impostors = nullptr;
+    Minimap* _minimap = nullptr;
+    std::vector<Renderable*> _renderables;
+
+    // { vaoIndex - AABB degli alberi del chunk }
+    std::vector<std::vector<aabb*>> _forestAABBs;
+    std::vector<aabb*> _fenceAABBs;
+
+    void _initFenceAABBs();
+
+public:
+    WorldCache(WorldCache const&) = delete;
+    void operator=(WorldCache const&) = delete;
+
+    static WorldCache& getInstance() {
+        static WorldCache instance;
+        return instance;
+    }
+
+    // Genera il mondo solo se non e' gia' stato generato
+    void build(const uint32_t mapSeed, const std::map<int, glm::vec3>& poiInfo);
+
+    inline bool isBuilt() const { return _built; }
+
+    // Prepara il mondo per una nuova partita: nasconde i chunk dei POI e registra le collisioni di quelli visibili.
+    // Restituisce gli AABB registrati (per il debug)
+    std::vector<aabb*> beginRun(const std::unordered_set<int>& hiddenChunks, const std::map<int, glm::vec3>& poiInfo, CollisionSolver& collisionSolver);
+
+    // Renderable di proprieta' della cache, da non liberare nella scena
+    inline const std::vector<Renderable*>& renderables() const { return _renderables; }
+
+    virtual MemoryUsage memoryUsage() const override;
+
+    void clear();
+};
+
+void WorldCache::_initFenceAABBs() {
+    _fenceAABBs.push_back(new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT, -4.0f, MAX_PLAYER_DISTANCE_FRONT + 0.25f), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT, 0.0f, MAX_PLAYER_DISTANCE_FRONT - 0.25f)));
+    _fenceAABBs.push_back(new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT, -4.0f, MAX_PLAYER_DISTANCE_BACK + 0.25f), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT, 0.0f, MAX_PLAYER_DISTANCE_BACK - 0.25f)));
+    _fenceAABBs.push_back(new aabb(glm::vec3(MAX_PLAYER_DISTANCE_RIGHT + 0.25, -4.0f, MAX_PLAYER_DISTANCE_BACK), glm::vec3(MAX_PLAYER_DISTANCE_RIGHT - 0.25f, 0.0f, MAX_PLAYER_DISTANCE_FRONT)));
+    _fenceAABBs.push_back(new aabb(glm::vec3(MAX_PLAYER_DISTANCE_LEFT - 0.25f, -4.0f, MAX_PLAYER_DISTANCE_BACK), glm::vec3(MAX_PLAYER_DISTANCE_LEFT + 0.25f, 0.0f, MAX_PLAYER_DISTANCE_FRONT)));
+}
+
+void WorldCache::build(const uint32_t mapSeed, const std::map<int, glm::vec3>& poiInfo) {
+    if (_built)
+        return;
+
+    _renderables.push_back(new Floor());
+    _renderables.push_back(new DynamicMapRenderable(DynamicEntity::grass, mapSeed));
+
+    // Gli alberi si generano anche nei chunk dei POI, che vengono nascosti partita per partita
+    unordered_set<int> tabooIndices = unordered_set<int>();
+    for (int index : K_SET_TO_EXCLUDE)
+        tabooIndices.insert(index);
+
+    _forest = new DynamicMapRenderable(DynamicEntity::tree, mapSeed, tabooIndices);
+    _renderables.push_back(_forest);
+    if (USE_TREE_IMPOSTORS) {
+        // L'atlas degli impostor viene renderizzato una volta sola: le texture devono essere gia' residenti
+        TextureUploadQueue::getInstance().finish();
+        _impostors = new TreeImpostorRenderable(*_forest);
+        _renderables.push_back(_impostors);
+    }
+    _forestAABBs = _forest->toChunkAABBs();
+
+    _renderables.push_back(new Fence());
+    _initFenceAABBs();
+
+    _minimap = new Minimap(poiInfo);
+    _renderables.push_back(_minimap);
+
+    _built = true;
+}
+
+std::vector<aabb*> WorldCache::beginRun(const std::unordered_set<int>& hiddenChunks, const std::map<int, glm::vec3>& poiInfo, CollisionSolver& collisionSolver) {
+    _forest->setTabooIndices(hiddenChunks);
+    if (_impostors != nullptr)
+        _impostors->setHiddenChunks(hiddenChunks);
+    _minimap->setPointsOfInterest(poiInfo);
+
+    std::vector<aabb*> registered;
+    for (size_t k = 0; k < _forestAABBs.size(); k++) {
+        if (hiddenChunks.find(static_cast<int>(k)) != hiddenChunks.end())
+            continue;
+        registered.insert(registered.end(), _forestAABBs[k].begin(), _forestAABBs[k].end());
+    }
+    registered.insert(registered.end(), _fenceAABBs.begin(), _fenceAABBs.end());
+
+    collisionSolver.registerSharedAABBs(registered);
+    return registered;
+}
+
+MemoryUsage WorldCache::memoryUsage() const {
+    MemoryUsage usage;
+    for (auto renderable : _renderables)
+        usage += renderable->memoryUsage();
+
+    for (const auto& chunk : _forestAABBs)
+        usage.cpuBytes += vectorBytes(chunk) + chunk.size() * sizeof(aabb);
+    usage.cpuBytes += vectorBytes(_forestAABBs) + vectorBytes(_fenceAABBs) + _fenceAABBs.size() * sizeof(aabb);
+    return usage;
+}
+
+void WorldCache::clear() {
+    for (auto renderable : _renderables)
+        delete renderable;
+    _renderables.clear();
+    _forest = nullptr;
+    _impostors = nullptr;
+    _minimap = nullptr;
+
+    for (auto& chunk : _forestAABBs)
+        for (auto forestAABB : chunk)
+            delete forestAABB;
+    _forestAABBs.clear();
+
+    for (auto fenceAABB : _fenceAABBs)
+        delete fenceAABB;
+    _fenceAABBs.clear();
+
+    _built = false;
+}